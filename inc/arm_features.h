@@ -27,6 +27,9 @@ enum arm_feature {
   /* Atomics etc */
   FEAT_LSE,
 
+  /* TLB maintenance by range of VAs */
+  FEAT_TLBIRANGE,
+
   NO_ARM_FEATURES,
 };
 
@@ -51,6 +54,7 @@ struct arch_feature_matrix
 /* instruction set attribute register(s) */
 #define ISAR0_FIELD_ATOMIC 23, 20
 #define ISAR0_FIELD_ATOMIC_LSB 20
+#define ISAR0_FIELD_TLB 59, 56
 
 /* memory model feature register(s) */
 #define MMFR0_FIELD_ASIDBits 7, 4
@@ -6,9 +6,13 @@ typedef enum { BOOT_KIND_PSCI, BOOT_KIND_SPIN } boot_kind_t;
 typedef struct
 {
   boot_kind_t kind;
+
+  /* the MPIDR of each CPU, from its dtb reg */
+  u64 mpidr[MAX_CPUS];
+
   union {
     u64 psci_base;
-    u64 spin_base[4];
+    u64 spin_base[MAX_CPUS];
   };
 } boot_data_t;
 
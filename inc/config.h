@@ -10,6 +10,31 @@ extern u8 ENABLE_PGTABLE;
 extern u8 ENABLE_PERF_COUNTS;
 extern u8 RUN_FOREVER;
 
+/** prepare the next batch on the spare CPUs
+ * while the current one is running */
+extern u8 ENABLE_PIPELINED_BATCHES;
+
+/** partition the CPUs into groups
+ * each running its own instance of the test */
+extern u8 ENABLE_CPU_GROUPS;
+
+/** measure the time spent in each phase of the harness
+ * and print it with the results */
+extern u8 ENABLE_PROFILE;
+
+/** map the harness with global entries
+ * shared between all test pagetables */
+extern u8 ENABLE_GLOBAL_HARNESS;
+
+/** size of the virtual address space,
+ * which decides the level translation table walks start at */
+extern u64 VA_BITS;
+
+/** PMU events to count around each run
+ * and report per outcome */
+extern u64 PMU_EVENTS[];
+extern u64 NO_PMU_EVENTS;
+
 /** enable/disable collecting results histogram
  * and (if -t) print results direct to serial */
 extern u8 ENABLE_RESULTS_HIST;
@@ -35,6 +60,7 @@ extern u8 ENABLE_COLOUR;
 
 extern u8 ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM;
 extern u8 ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR;
+extern u8 ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED;
 
 typedef enum {
   WARN_UNEXPECTED_EXCEPTION,
@@ -84,6 +110,14 @@ typedef enum {
 
 extern output_style_t OUTPUT_FORMAT;
 
+/* implementation of bwait() */
+typedef enum {
+  BARRIER_LOCKFREE,
+  BARRIER_LOCKED,
+} barrier_type_t;
+
+extern barrier_type_t BARRIER_TYPE;
+
 /* litmus-specific options */
 typedef enum {
   SYNC_NONE,
@@ -104,6 +138,7 @@ extern aff_type_t LITMUS_AFF_TYPE;
 typedef enum {
   SHUF_NONE,
   SHUF_RAND,
+  SHUF_FEISTEL,
 } shuffle_type_t;
 
 extern shuffle_type_t LITMUS_SHUFFLE_TYPE;
@@ -112,6 +147,7 @@ typedef enum {
   CONCRETE_LINEAR,
   CONCRETE_RANDOM,
   CONCRETE_FIXED,
+  CONCRETE_PLANNED,
 } concretize_type_t;
 
 extern concretize_type_t LITMUS_CONCRETIZATION_TYPE;
@@ -121,6 +157,7 @@ typedef enum {
   RUNNER_ARRAY,
   RUNNER_SEMI_ARRAY,
   RUNNER_EPHEMERAL,
+  RUNNER_PIPELINED,
 } litmus_runner_type_t;
 
 extern litmus_runner_type_t LITMUS_RUNNER_TYPE;
@@ -131,6 +168,7 @@ char* aff_type_to_str(aff_type_t ty);
 char* shuff_type_to_str(shuffle_type_t ty);
 char* concretize_type_to_str(concretize_type_t ty);
 char* runner_type_to_str(litmus_runner_type_t ty);
+char* barrier_type_to_str(barrier_type_t ty);
 
 /* helper functions for displaying help */
 void display_help_and_quit(void);
@@ -42,11 +42,28 @@ extern u64 __asid_size;
 #define PSCI_CPU_ON 0xC4000003UL /* SMC64 starts at 0xC4... */
 #define PSCI_CPU_OFF 0x84000002UL
 
-#define MAX_CPUS 4
+/** the most physical CPUs the harness supports
+ *
+ * per-CPU data (thread_infos, cpu_data, vector tables etc) is statically sized by this,
+ * can be overridden at build time with make MAX_CPUS=N
+ */
+#ifndef MAX_CPUS
+#define MAX_CPUS 128
+#endif
 
-/** number of physical hardware threads */
+/** number of physical hardware threads
+ * read from the number of cpu@N nodes in the dtb
+ */
 extern u64 NO_CPUS;
 
+/** convert a MPIDR_EL1 to a CPU number
+ *
+ * KVM and QEMU's virt machine place 16 CPUs in each Aff1 cluster,
+ * see init_cpu in cpu_entry.S which does the same.
+ */
+#define MPIDR_TO_CPU(mpidr) (((((mpidr) >> 8) & 0xff) << 4) | ((mpidr)&0xf))
+#define CPU_TO_MPIDR(cpu) ((((cpu) >> 4) << 8) | ((cpu)&0xf))
+
 /* top and bottom of physical memory */
 extern u64 TOP_OF_MEM;
 
@@ -134,6 +151,10 @@ extern u64* TESTDATA_MMAP;
 extern u64 BOT_OF_TESTDATA;
 extern u64 TOP_OF_TESTDATA;
 
+/* how many of the NR_REGIONS test data regions fit in the physical testdata space
+ */
+extern u64 NO_TESTDATA_REGIONS;
+
 /**
  * physical adddress the vector tables are located at
  *
@@ -199,6 +220,7 @@ fdt_structure_property_header* fdt_read_prop(char* fdt, fdt_structure_begin_node
 fdt_structure_property_header* fdt_find_prop(char* fdt, char* node_name, char* prop_name);
 
 char* dtb_bootargs(void* fdt);
+u64 dtb_read_no_cpus(void* fdt);
 
 typedef struct
 {
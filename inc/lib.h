@@ -20,6 +20,7 @@
 #include "sync.h"
 #include "asm.h"
 #include "caches.h"
+#include "pmu.h"
 #include "vmm.h"
 #include "exceptions.h"
 #include "rand.h"
@@ -73,7 +74,7 @@ typedef struct
   volatile int finished;
 } cpu_data_t;
 
-extern cpu_data_t cpu_data[4];
+extern cpu_data_t cpu_data[MAX_CPUS];
 
 extern void cpu_data_init(void);
 extern void cpu_boot(u64 cpu);
@@ -20,42 +20,29 @@ static inline u8 owns_region(var_info_t* vinfo, own_level_t r) {
   return (vinfo->ty == VAR_HEAP && vinfo->heap.owned_region_size == r);
 }
 
-/** this region ticker keeps track
- * of the current directory and page in that directory
- * for each region
+/** the region trackers keep track of which of the test data is in use
+ * as a hierarchical bitmap:
+ * one bit per cache line, with summary words of which pages of each dir,
+ * and which dirs of each region, have anything in them
  *
- * this is useful during initial allocation of the test data
- * to regions and pages
+ * so checking a line is at most three word lookups,
+ * finding a free page or dir is a CLZ over the summary words,
+ * and clearing only visits what was marked.
  *
- * we assume each cache line = 16 words aka 64 cache lines per page
+ * the trackers are indexed by physical address,
+ * so they also catch different VAs (e.g. identity mapped ones) of the same data.
+ * each 8M region of test data is mapped contiguously (see vmm_regions.h),
+ * so an offset into a region is the same in the VA and the PA.
+ *
+ * lines are the size of the smallest cache line (CACHE_LINE_SHIFT),
+ * but never smaller than 1/64th of a page.
  */
-#define NR_u64_PER_CACHE_LINE 8
-#define NR_CACHE_LINES_PER_PAGE 64
-
-typedef struct
-{
-  const char* exclusive_owner; /* if some var owns this cache line, its name, otherwise NULL */
-  u64 curr_val_ix;
-} cache_line_tracker_t;
-
-typedef struct
-{
-  const char* exclusive_owner; /* if some var owns this page, its name, otherwise NULL */
-  u64 curr_scl_ix;
-  cache_line_tracker_t scl_ix[NR_CACHE_LINES_PER_PAGE];
-} page_tracker_t;
-
-typedef struct
-{
-  const char* exclusive_owner; /* if some var owns this dir, its name, otherwise NULL */
-  u64 curr_page_ix;
-  page_tracker_t page_ixs[NR_PAGES_PER_DIR];
-} dir_tracker_t;
 
 typedef struct
 {
-  u64 curr_dir_ix;
-  dir_tracker_t dir_ixs[NR_DIRS_PER_REGION];
+  u64 dirs;                                             /* bit d: dir d has something taken */
+  u64 pages[NR_DIRS_PER_REGION][NR_PAGES_PER_DIR / 64]; /* bit p: page p of the dir has something taken */
+  u64* lines[NR_DIRS_PER_REGION]; /* lines[d][p] bit l: line l of page p is taken (allocated on first use) */
 } region_tracker_t;
 
 typedef struct
@@ -63,10 +50,35 @@ typedef struct
   region_tracker_t regions[NR_REGIONS];
 } region_trackers_t;
 
-region_tracker_t* tracker_region(regions_t* regions, region_trackers_t* trackers, u64* va);
-dir_tracker_t* tracker_dir(regions_t* regions, region_trackers_t* trackers, u64* va);
-page_tracker_t* tracker_page(regions_t* regions, region_trackers_t* trackers, u64* va);
-cache_line_tracker_t* tracker_cache_line(regions_t* regions, region_trackers_t* trackers, u64* va);
+region_trackers_t* alloc_region_trackers(void);
+void free_region_trackers(region_trackers_t* trackers);
+
+/** mark the cache line of the physical address pa as taken
+ *
+ * PAs outside of the test data are not tracked
+ */
+void tracker_mark(region_trackers_t* trackers, u64 pa);
+
+/** whether the cache line of the physical address pa was marked */
+bool tracker_is_taken(region_trackers_t* trackers, u64 pa);
+
+/** find the highest page (or dir) of region reg with nothing marked in it
+ * at or below offset offs, wrapping around to the top of the region if there are none.
+ *
+ * writes the offset of the start of the page (or dir) to out,
+ * and returns false if every page (or dir) has something marked.
+ */
+bool tracker_find_free_page(region_trackers_t* trackers, u64 reg, u64 offs, u64* out);
+bool tracker_find_free_dir(region_trackers_t* trackers, u64 reg, u64 offs, u64* out);
+
+/** un-mark everything */
+void tracker_clear(region_trackers_t* trackers);
+
+/** the first var that the linear concretization cannot place,
+ * because it neither owns a region nor is pinned to a var that does,
+ * or NULL if it can place them all
+ */
+var_info_t* concretize_linear_unplaced_var(test_ctx_t* ctx, const litmus_test_t* cfg);
 
 /* generic concretization functions */
 
@@ -86,6 +98,17 @@ void concretize_batch(
   run_count_t batch_end_idx
 );
 
+/** concretize the batch [batch_start_idx, batch_end_idx)
+ * such that its PAs also do not overlap those of the runs from avoid_start_idx
+ *
+ * used by the pipelined runner, where the previous batch is still running
+ * while the next one is being concretized.
+ */
+void concretize_batch_avoiding(
+  concretize_type_t type, test_ctx_t* ctx, const litmus_test_t* cfg, run_count_t avoid_start_idx,
+  run_count_t batch_start_idx, run_count_t batch_end_idx
+);
+
 void write_init_state(test_ctx_t* ctx, const litmus_test_t* cfg, run_idx_t run);
 void write_init_states(test_ctx_t* ctx, const litmus_test_t* cfg, run_idx_t no_runs);
 
@@ -37,9 +37,10 @@ typedef struct
  *
  * instead owe allocate 8 M which is more than enough for the current tests
  *
- * For now this region is physically contiguous, in future we may
- * want to make this a virtual array where only some of the points
- * are mapped in, allowing tests over a wider range of VAs.
+ * Each region is backed by its own physically contiguous 8M slice of the test data memory,
+ * and the VA<->PA conversions in vmm_regions.h depend on that.
+ * Regions are not yet virtual windows where only the pages in use are backed,
+ * so the test data VA space in use is still limited by physical memory (see NO_TESTDATA_REGIONS).
  */
 #define NR_DIRS_PER_REGION 4
 #define REGION_SHIFT (2 + PMD_SHIFT)
@@ -56,11 +57,12 @@ typedef struct
  * so here we store a reference to the start of each
  *
  * right now each region is 8M
- * and we allocate 16 of them for the tests
- * for a total of 64M of test data space to play with
+ * and there is VA space for up to 64 of them, one per 1G of the 64G TESTDATA_MMAP,
+ * but only the first NO_TESTDATA_REGIONS are used, as many as there is physical memory for
+ * (512M of test data space with all 64)
  */
-#define NR_REGIONS 16
-#define NR_REGIONS_SHIFT 4
+#define NR_REGIONS 64
+#define NR_REGIONS_SHIFT 6
 typedef struct
 {
   region_t* regions[NR_REGIONS];
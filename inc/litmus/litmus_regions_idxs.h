@@ -21,7 +21,7 @@ region_idx_t align_up_region_idx(region_idx_t idx, pin_level_t alignment);
 
 u64 va_from_region_idx(test_ctx_t* ctx, var_info_t* var, region_idx_t idx);
 
-region_idx_t region_idx_top(void);
-region_idx_t region_idx_bottom(void);
+region_idx_t region_idx_top(test_ctx_t* ctx);
+region_idx_t region_idx_bottom(test_ctx_t* ctx);
 
 #endif /* LITMUS_REGIONS_IDXS_H */
\ No newline at end of file
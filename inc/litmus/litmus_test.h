@@ -4,6 +4,7 @@
 #include "litmus_idxs.h"
 #include "litmus_test_def.h"
 #include "litmus_test_results.h"
+#include "litmus_test_profile.h"
 #include "litmus_test_ctx.h"
 
 /* entry point for tests */
@@ -40,16 +40,45 @@ struct test_ctx
   bar_t* generic_cpu_barrier;  /* generic wait-for-all-cpus */
   bar_t* generic_vcpu_barrier; /* generic wait-for-all-vcpus */
   bar_t* start_barriers;       /* per-run barrier for start */
-  run_idx_t* shuffled_ixs;
+  run_idx_t* shuffled_ixs;           /* with --shuffle=rand, otherwise NULL */
   run_count_t* shuffled_ixs_inverse; /* the inverse lookup of shuffled_ixs */
+  permutation_t shuffle_perm;        /* with --shuffle=feistel */
   volatile int* affinity;
   test_hist_t* hist;
+  test_hist_t** staged_hists; /* per-CPU results of the current batch, see end_of_batch */
+  test_profile_t* profile;    /* with --profile, time spent in each phase, otherwise NULL */
+  u64** pmu_counts;           /* with --pmu-events, pmu_counts[event][run * no_threads + thread], otherwise NULL */
   run_idx_t current_run;
   u64** ptables;
   u64 current_EL;
   u64 privileged_harness;  /* require harness to run at EL1 between runs ? */
   u64 last_tick;           /* clock ticks since last verbose print */
   void* concretization_st; /* current state of the concretizer */
+  region_trackers_t* batch_trackers; /* the test data used by the batch being concretized, otherwise NULL */
+
+  /** the group of physical CPUs running this instance of the test
+   *
+   * with --cpu-groups the CPUs are partitioned into no_groups disjoint groups
+   * each running its own test_ctx_t, on its own ASIDs and heap regions.
+   * otherwise there is a single group of all the CPUs.
+   */
+  u64 group;
+  u64 no_groups;
+  u64 cpu_base;       /* first physical CPU of the group */
+  u64 no_cpus;        /* number of CPUs in the group */
+  u64 asid_base;      /* the ASIDs of this group start after this one */
+  u64 asid_range;     /* ... and there are this many of them */
+  u64 heap_region_lo; /* this group only uses heap_memory.regions[lo..hi) */
+  u64 heap_region_hi;
+
+  /** TLB maintenance statistics, see asid_from_run_count */
+  u64 tlbi_count_start; /* tlbi_count() at the start of the test */
+  u64 asid_rollovers;   /* number of new ASID generations */
+
+  /** concretization statistics, see concretize_batch_avoiding */
+  u64 concretize_runs;         /* runs concretized one at a time */
+  u64 concretize_attempts;     /* attempts at picking VAs for them, including retries */
+  u64 concretize_max_attempts; /* the most attempts any one run took */
 
   /** checkpoint to restore the ptable allocator back to at the end
    */
@@ -62,6 +91,18 @@ struct test_ctx
 void init_test_ctx(test_ctx_t* ctx, const litmus_test_t* cfg, int no_runs, int runs_in_batch);
 void free_test_ctx(test_ctx_t* ctx);
 
+/** the number of groups to partition no_cpus CPUs into for this test
+ * (see --cpu-groups)
+ *
+ * worked out from the cfg alone, before any ctx is made
+ */
+u64 cfg_no_cpu_groups(const litmus_test_t* cfg, u64 no_cpus);
+
+/** assign the ctx to one group of CPUs
+ * giving it its share of the CPUs, ASIDs and heap regions
+ */
+void set_ctx_cpu_group(test_ctx_t* ctx, u64 group, u64 no_groups);
+
 /* helper functions */
 u64 ctx_pa(test_ctx_t* ctx, run_idx_t run, u64 va);
 u64* ctx_pte(test_ctx_t* ctx, run_idx_t run, u64 va);
@@ -74,9 +115,21 @@ const char* regname_from_idx(test_ctx_t* ctx, var_idx_t idx);
 
 run_count_t run_count_from_idx(test_ctx_t* ctx, run_idx_t idx);
 u64* ptable_from_run(test_ctx_t* ctx, run_idx_t i);
+u64 ptable_idx_from_run_count(test_ctx_t* ctx, run_count_t r);
 u64 asid_from_run(test_ctx_t* ctx, run_idx_t i);
+
+/** ASIDs are handed out to batches in generations, like Linux does on arm64
+ *
+ * each batch takes the next ASIDs from the group's range,
+ * which have not been used since the TLB was last flushed and so need no invalidation.
+ * once the range runs out, a new generation starts back at the bottom,
+ * after a single TLBI VMALLE1IS.
+ */
 u64 asid_from_run_count(test_ctx_t* ctx, run_count_t r);
 
+/* whether the batch starting at r is the first of a new ASID generation */
+bool asid_generation_starts_at(test_ctx_t* ctx, run_count_t r);
+
 /* for loading var_info_t */
 void read_var_infos(const litmus_test_t* cfg, init_system_state_t* sys_st, var_info_t* infos, int no_runs);
 
@@ -0,0 +1,77 @@
+#ifndef LITMUS_TEST_PROFILE_H
+#define LITMUS_TEST_PROFILE_H
+
+#include "lib.h"
+
+/** the phases of the harness' main loop that --profile measures
+ *
+ * see run_thread in litmus_test.c
+ */
+typedef enum {
+  PROF_ALLOCATE_BATCH,    /* allocate_data_for_batch (and allocate_data_for_next_batch) */
+  PROF_SETUP_RUN_DATA,    /* setup_run_data */
+  PROF_PREPARE_CONTEXTS,  /* prepare_test_contexts */
+  PROF_SWITCH_TO_TEST,    /* switch_to_test_context and the setup function */
+  PROF_BWAIT_START,       /* the start barrier, just before the test function */
+  PROF_TEST,              /* the test function itself */
+  PROF_RETURN_TO_HARNESS, /* the teardown function and return_to_harness_context */
+  PROF_BWAIT_RUN,         /* the barriers at the end of each run */
+  PROF_BWAIT_BATCH,       /* the barriers at the start of each batch */
+  PROF_END_OF_BATCH,      /* end_of_batch, collecting the results */
+  PROF_CLEAN_RUN_DATA,    /* clean_run_data */
+  PROF_THREAD,            /* the whole of run_thread */
+  NUM_PROF_PHASES,
+} prof_phase_t;
+
+const char* prof_phase_to_str(prof_phase_t phase);
+
+/** each sample is put in one of PROF_NUM_BUCKETS log-linear buckets
+ * to approximate the percentiles without keeping every sample:
+ * values below 16 get their own bucket, and each power of 2 above that is split into 8.
+ */
+#define PROF_MAX_SHIFT 40
+#define PROF_NUM_BUCKETS (16 + (PROF_MAX_SHIFT - 4) * 8)
+
+typedef struct
+{
+  u64 total; /* sum of all samples */
+  u64 count; /* number of samples */
+  u32 buckets[PROF_NUM_BUCKETS];
+} prof_counter_t;
+
+/** per-CPU, per-phase counters
+ * of the PMU cycle counter (or the generic timer without FEAT_PMUv3)
+ */
+typedef struct
+{
+  u64 no_cpus;
+  u8 use_pmu; /* read once at allocation, as the ID registers are not readable from EL0 */
+  prof_counter_t counters[]; /* counters[cpu * NUM_PROF_PHASES + phase] */
+} test_profile_t;
+
+test_profile_t* alloc_profile(u64 no_cpus);
+void free_profile(test_profile_t* profile);
+
+/** read the counter the profile uses */
+u64 prof_now(test_profile_t* profile);
+
+/** add one sample for phase on cpu, of the time since start */
+void prof_record(test_profile_t* profile, u64 cpu, prof_phase_t phase, u64 start);
+
+/** add all the samples of from into into */
+void merge_profile(test_profile_t* into, test_profile_t* from);
+
+/** print the breakdown of where the harness spent its time */
+void print_profile(test_ctx_t* ctx);
+
+/** run stmt, and if profiling then record how long it took against phase
+ */
+#define PROFILE(ctx, cpu, phase, stmt)                                \
+  do {                                                                \
+    u64 __prof_start = (ctx)->profile ? prof_now((ctx)->profile) : 0; \
+    stmt;                                                             \
+    if ((ctx)->profile)                                               \
+      prof_record((ctx)->profile, cpu, phase, __prof_start);          \
+  } while (0)
+
+#endif /* LITMUS_TEST_PROFILE_H */
@@ -11,14 +11,44 @@ typedef struct
   u64 values[];
 } test_result_t;
 
+/** histogram of observed outcomes
+ *
+ * the distinct outcomes are kept in one contiguous block, in the order they were first seen,
+ * with an open-addressing hash table over the register values for finding them again.
+ *
+ * both are grown (doubled) from the heap as they fill up,
+ * so there is no limit on the number of distinct outcomes.
+ */
 typedef struct
 {
-  u64 allocated;
-  u64 limit;
-  test_result_t** lut;
-  test_result_t* results[];
+  u64 allocated;   /* number of distinct outcomes seen */
+  u64 limit;       /* number of outcomes there is space for in results */
+  u64 result_size; /* size of each test_result_t in results */
+  void* results;
+  u64 table_size; /* number of slots in the table, a power of 2 */
+  u64* table;     /* 1+index into results, or 0 for an empty slot */
 } test_hist_t;
 
+static inline test_result_t* hist_result(test_hist_t* hist, u64 i) {
+  return (test_result_t*)((u8*)hist->results + hist->result_size * i);
+}
+
+/** allocate/free a histogram
+ * with initial space for limit distinct outcomes, limit must be a power of 2 */
+test_hist_t* alloc_hist(const litmus_test_t* cfg, u64 limit);
+void free_hist(test_hist_t* hist);
+
+/* forget all outcomes in the histogram, keeping the allocation */
+void clear_hist(test_hist_t* hist);
+
+/** collect the results of runs [from, to) into a staging histogram
+ * then later merge them into the main one
+ *
+ * merge_results clears the staging histogram afterwards.
+ */
+void stage_results(test_ctx_t* ctx, test_hist_t* staging, run_count_t from, run_count_t to);
+void merge_results(test_ctx_t* ctx, test_hist_t* into, test_hist_t* from);
+
 /* print the collected results out */
 void print_results(test_hist_t* results, test_ctx_t* ctx);
 
@@ -0,0 +1,44 @@
+#ifndef PMU_H
+#define PMU_H
+
+#include "lib.h"
+
+/** the maximum number of PMUv3 event counters that --pmu-events can use
+ *
+ * the architecture guarantees at least 6 (PMCR_EL0.N)
+ */
+#define PMU_MAX_EVENTS 6
+
+/** returned by pmu_event_from_str for unrecognised events */
+#define PMU_EVENT_UNKNOWN (~0UL)
+
+/** the PMUv3 common event number for either a name (e.g. "l1d_refill")
+ * or a raw hex event number (e.g. "0x03"), of at most 0xffff
+ */
+u64 pmu_event_from_str(char* name);
+
+/** the name of the event, or NULL if it is not one of the named events */
+const char* pmu_event_to_str(u64 event);
+
+/** print the event's name, or its number if it has none */
+void sprint_pmu_event(STREAM* out, u64 event);
+
+/** the number of event counters this CPU implements
+ *
+ * must be called at EL1
+ */
+u64 pmu_no_counters(void);
+
+/** program and enable event counters 0..n-1 to count events[0..n-1] at EL0 and EL1
+ *
+ * must be called at EL1, on each CPU that will read them
+ */
+void pmu_program_events(u64* events, u64 n);
+
+/** read the current value of event counters 0..n-1 into out
+ *
+ * can be called from EL0, per_cpu_setup sets PMUSERENR_EL0.EN
+ */
+void pmu_read_events(u64* out, u64 n);
+
+#endif /* PMU_H */
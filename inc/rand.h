@@ -2,12 +2,47 @@
 #define RAND_H
 
 extern volatile u64 INITIAL_SEED;
+
+/* the seed the generators were last (re)seeded with */
 extern volatile u64 SEED;
 
 void init_seed(void);
+
+/** (re)seed the per-CPU generators
+ *
+ * the numbers each CPU generates after this depend only on the seed and that CPU's number
+ * reset_seed() goes back to the INITIAL_SEED
+ */
 void reset_seed(void);
 void rand_seed(u64 seed);
+
+/** random numbers from the current CPU's generator
+ * these do not take any locks */
 u64 randn(void);
+void randn_fill(u64* out, u64 n);
 u64 randrange(u64 low, u64 hi);
 void shuffle(void* arr, u64 szof, u64 n);
+
+/** a random permutation of [0, n) that can be computed pointwise
+ * without storing it
+ *
+ * this is a balanced Feistel network over the smallest even number of bits that covers n,
+ * which is a bijection on [0, 2^bits), restricted to [0, n) by cycle-walking:
+ * re-applying it until the result falls back in range.
+ */
+#define PERMUTATION_ROUNDS 4
+
+typedef struct
+{
+  u64 n;
+  u64 half_bits;
+  u64 keys[PERMUTATION_ROUNDS];
+} permutation_t;
+
+/* pick a new random permutation of [0, n) */
+void init_permutation(permutation_t* perm, u64 n);
+
+/* the image of i under the permutation, and the inverse */
+u64 permute(permutation_t* perm, u64 i);
+u64 unpermute(permutation_t* perm, u64 i);
 #endif /* RAND_H */
@@ -54,16 +54,38 @@ void unlock(volatile lock_t* lock);
     unlock(lockptr);                                                      \
   })
 
-/* barrier */
+/* barrier
+ *
+ * there are two implementations of bwait(), selected with --barrier:
+ *  - locked: serialises each arrival through a global lock,
+ *            works with either the lamport lock or the mutex.
+ *  - lockfree: an atomic arrival counter and an epoch (sense) flag per barrier,
+ *              needs exclusives and so the MMU to be on.
+ *
+ * the lock-based fields are kept separate from the lock-free ones
+ * so a barrier can be used by either.
+ */
+
+/** each bar_t gets its own cache line
+ * so that threads spinning on one barrier (e.g. start_barriers[i])
+ * do not keep stealing the line of its neighbour.
+ */
+#define BAR_ALIGN 64
+
 typedef struct
 {
+  /* locked barrier */
   volatile u64 iteration;
   volatile u64 waiting;
   u8 current_state;
-} bar_t;
+
+  /* lock-free barrier */
+  volatile u64 arrived;
+  volatile u64 epoch;
+} __attribute__((aligned(BAR_ALIGN))) bar_t;
 
 #define EMPTY_BAR \
-  (bar_t) { 0, 0, 0 }
+  (bar_t) { 0, 0, 0, 0, 0 }
 
 void bwait(int cpu, bar_t* barrier, int sz);
 
@@ -52,6 +52,50 @@ typedef struct __alloc
  */
 #define NUM_ALLOC_CHUNKS 1024
 
+/** small allocations are served from slabs
+ *
+ * a slab is one page cut into objects of one power-of-2 size class, from SLAB_MIN_SIZE up to SLAB_MAX_SIZE.
+ * the page starts with the valloc_slab header, which has a bit for each object
+ * saying whether it is allocated, so allocation and free of an object do not search any lists.
+ *
+ * slab pages are taken from the bottom of the heap, growing up towards mem.top,
+ * so they never sit between the chunks of the rest of the allocator.
+ *
+ * each size class keeps one empty slab cached, so a loop that allocates and frees
+ * a single object does not take and give back a page each time.
+ * a slab page is only given back when a second slab of the same class empties.
+ */
+#define SLAB_MIN_SHIFT 5
+#define SLAB_MAX_SHIFT 8
+#define SLAB_MIN_SIZE (1UL << SLAB_MIN_SHIFT)
+#define SLAB_MAX_SIZE (1UL << SLAB_MAX_SHIFT)
+#define NUM_SLAB_CLASSES (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+
+/* the largest the heap can be, see TOTAL_HEAP */
+#define SLAB_MAX_HEAP_PAGES ((64 * MiB) / PAGE_SIZE)
+
+typedef struct __slab
+{
+  struct __slab* prev;
+  struct __slab* next;
+  u64 shift;   /* log2 of the object size */
+  u64 no_used; /* number of allocated objects */
+  u64 used[2]; /* one bit per object, the bits past the last object are always set */
+} valloc_slab;
+
+typedef struct
+{
+  valloc_slab* partial; /* the slabs with at least one free object, except the empty one */
+  valloc_slab* empty;   /* the cached empty slab, or NULL */
+
+  /* statistics, for debug_valloc_status */
+  u64 no_allocs;
+  u64 no_frees;
+  u64 no_live;   /* currently allocated objects */
+  u64 no_slabs;  /* current number of slabs, including the empty one */
+  u64 max_slabs; /* the most slabs there have been at once */
+} valloc_slab_class;
+
 /** the memory itself is just a moving bar that
  * goes from the top of memory down towards the top
  * of stack
@@ -63,6 +107,10 @@ typedef struct
   valloc_alloc_chunk chunks[NUM_ALLOC_CHUNKS];
   valloc_alloc_chunk* chunk_unalloc_list;
   valloc_alloc_chunk* chunk_alloc_list;
+  valloc_slab_class slab_classes[NUM_SLAB_CLASSES];
+  u64 slab_top;                 /* the slab pages are in [BOT_OF_HEAP, slab_top) */
+  valloc_slab* slab_free_pages; /* the pages below slab_top given back by their slab */
+  u64 slab_pages[SLAB_MAX_HEAP_PAGES / 64]; /* one bit for each page of heap, set if it is a slab */
 } valloc_mempool;
 
 /* global memory pool to allocate from */
@@ -81,7 +129,24 @@ void valloc_freelist_allocate_free_chunk(u64 addr, u64 size);
 void valloc_freelist_remove_chunk(valloc_free_chunk* chunk);
 void valloc_freelist_compact_chunk(valloc_free_chunk* chunk);
 
-#define ALLOC_SIZE(p) (valloc_alloclist_find_alloc_chunk(&mem, (u64)(p))->size)
+/** small objects are allocated from the slabs
+ * these must be called with __valloc_lock held
+ *
+ * valloc_slab_alloc returns NULL if the allocation is too big for a slab
+ * valloc_slab_free returns false if p was not allocated from a slab
+ * valloc_slab_size returns 0 if p was not allocated from a slab
+ */
+void* valloc_slab_alloc(u64 size, u64 alignment);
+bool valloc_slab_free(void* p);
+u64 valloc_slab_size(void* p);
+
+/** the number of bytes of slab pages with at least one allocated object */
+u64 valloc_slab_used_space(void);
+
+/** the size of the allocation at p */
+u64 valloc_alloc_size(void* p);
+
+#define ALLOC_SIZE(p) valloc_alloc_size((void*)(p))
 
 void init_valloc(void);
 
@@ -147,6 +147,18 @@ u64* vmm_alloc_new_4k_pgtable(void);
  */
 u64* vmm_alloc_new_test_pgtable(void);
 
+/** create the test translation table that vmm_alloc_new_test_pgtable copies
+ *
+ * new test tables get their own root but share the template's subtables,
+ * copying them on write: vmm_ensure_level makes the path to the entry private,
+ * so only the parts of the table a test's variables live in are ever copied.
+ */
+void vmm_alloc_test_pgtable_template(void);
+
+/** whether the (sub)table is one of the template's, shared between test pgtables
+ */
+bool vmm_table_is_shared(u64* table);
+
 /** free a given pagetable */
 void vmm_free_generic_pgtable(u64* root);
 void vmm_free_test_pgtable(u64* root);
@@ -185,6 +197,16 @@ void tlbi_va(u64 va);
 void tlbi_asid(u64 asid);
 void tlbi_all(void);
 
+/** invalidate the pages from va to va + no_pages*PAGE_SIZE (or more), for all ASIDs
+ *
+ * requires FEAT_TLBIRANGE,
+ * returns false (and does nothing) if the range is too large for one TLBI
+ */
+bool tlbi_va_range(u64 va, u64 no_pages);
+
+/* the total number of TLBIs issued so far, by all CPUs */
+u64 tlbi_count(void);
+
 /* synchronized TLB flushes */
 void vmm_flush_tlb_vaddr(u64 va);
 void vmm_flush_tlb(void);
@@ -204,6 +226,68 @@ void vmm_flush_tlb_asid(u64 asid);
  */
 void vmm_update_pte(u64* pte, u64 new_val, sync_type_t sync_kind, u64 asid_or_va, bool force);
 
+/* walk cache */
+
+/** the level 0-3 tables of the walk of root for va, if this CPU has them cached, otherwise NULL
+ */
+u64** vmm_walk_cache_lookup(u64* root, u64 va);
+
+/** walk root for va and cache the tables on the way
+ * returns NULL (and caches nothing) if the walk does not reach a level 3 table
+ */
+u64** vmm_walk_cache_fill(u64* root, u64 va);
+
+/** called before overwriting the value of a pagetable entry
+ * to flush cached walks that might go through it
+ */
+void vmm_walk_cache_note_write(u64* pte, u64 old_val, u64 new_val);
+
+/** flush all cached walks, on all CPUs */
+void vmm_walk_cache_flush(void);
+
+/* batched pgtable updates */
+
+/** the most updates a batch holds, after which it commits them early */
+#define VMM_PTE_BATCH_SIZE 64
+
+typedef struct
+{
+  u64* pte;
+  u64 new_val;
+  u64 va;
+} vmm_pte_update_t;
+
+/**
+ * vmm_pte_batch_t - A batch of pagetable entry updates, synchronised together.
+ * @sync_kind: what kind of TLB maintenance to perform for the whole batch.
+ * @asid: if sync by-ASID, the ASID of all the updates.
+ *
+ * vmm_commit_pte_batch() does break-before-make for all of the entries at once:
+ * it invalidates all the ones which were valid, then does one DSB and one TLB maintenance pass
+ * (a single range TLBI for SYNC_VA if the CPU has FEAT_TLBIRANGE),
+ * then writes all the new entries and does one DSB and one ISB.
+ *
+ * with SYNC_NONE the caller is promising nothing can be using the entries,
+ * so the new values are written directly with one DSB at the end.
+ */
+typedef struct
+{
+  sync_type_t sync_kind;
+  u64 asid;
+  u64 no_updates;
+  vmm_pte_update_t updates[VMM_PTE_BATCH_SIZE];
+} vmm_pte_batch_t;
+
+void vmm_begin_pte_batch(vmm_pte_batch_t* batch, sync_type_t sync_kind, u64 asid);
+
+/** queue writing new_val to pte, where va is the VA to invalidate if sync by-VA
+ * later updates to the same pte in the batch take priority.
+ */
+void vmm_batch_update_pte(vmm_pte_batch_t* batch, u64* pte, u64 new_val, u64 va);
+
+/** perform all the updates of the batch, leaving it empty */
+void vmm_commit_pte_batch(vmm_pte_batch_t* batch);
+
 /* for debugging and serializing */
 
 /** given a translation table
@@ -9,6 +9,13 @@
 #define PROT_SH_ISH 3
 
 #define PROT_NS_NON_SECURE 0
+
+/** not a hardware attribute,
+ * but tells vmm_make_desc to make a global (nG=0) entry
+ *
+ * bit 55 is one of the bits of a block or page descriptor reserved for software use.
+ */
+#define PROT_GLOBAL (1UL << 55)
 /** these define access permissions of the AP[2:1] bits
  * in the form PROT_el1_el0
  * where el1 are the permissions for EL1
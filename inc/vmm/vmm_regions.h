@@ -6,7 +6,7 @@
 
 /* at 16G starts the STACK va space */
 #define STACK_MMAP_BASE (16 * GiB)
-#define STACK_MMAP_SIZE (4 * STACK_SIZE)
+#define STACK_MMAP_SIZE (2 * MAX_CPUS * STACK_SIZE)
 
 /* thread0.EL0 is (16G+  STACK_SIZE -> 16G           )
  * thread0.EL1 is (16G+2*STACK_SIZE -> 16G+STACK_SIZE)
@@ -34,7 +34,7 @@
  * If no ENABLE_PGTABLE then VA and PA are the same.
  */
 #define VTABLE_MMAP_BASE (17 * GiB)
-#define VTABLE_MMAP_SIZE (16 * KiB)
+#define VTABLE_MMAP_SIZE (MAX_CPUS * PAGE_SIZE)
 
 #define THR_VTABLE_PA(t) ((u64*)(vector_base_pa + PAGE_SIZE * t))
 #define THR_VTABLE_VA(t) (ENABLE_PGTABLE ? (u64*)(VTABLE_MMAP_BASE + PAGE_SIZE * t) : THR_VTABLE_PA(t))
@@ -58,7 +58,7 @@
  * in the BOT_OF_TESTDATA -> TOP_OF_TESTDATA physical region
  * into a virtual mapping into the 64G region starting at 128G
  *
- * since we are allocating 16 * 8M contiguous regions uniformally over
+ * since we are allocating NR_REGIONS * 8M contiguous regions uniformally over
  * the physical space the calculation is simple:
  *
  * GapBetween8Ms = 128G / NumOfRegions
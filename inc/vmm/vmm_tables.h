@@ -13,9 +13,13 @@
 
 #define OFFS(va, lvl) BIT_SLICE(va, OFFSTOP(lvl), OFFSBOT(lvl))
 
-/* 8 bit ASIDs
- * ARM does support up to 16 bits with extensions,
- * but don't attept to detect that */
-#define MAX_ASID BITMASK(8)
+/* the level the hardware starts walking the 4-level tables at
+ * with at most 39 bits of VA space, TTBR0 points at the level 1 table for the bottom 512G
+ */
+#define VMM_START_LEVEL (VA_BITS <= 39 ? 1 : 0)
+
+/* 8 bit ASIDs, or 16 bit if the hardware supports them
+ * (see init_device and vmm_set_id_translation) */
+#define MAX_ASID BITMASK(ASID_SIZE)
 
 #endif /* VMM_TABLES_H */
@@ -2,7 +2,7 @@
 
 #include "vmm.h"
 
-thread_info_t thread_infos[4];
+thread_info_t thread_infos[MAX_CPUS];
 
 thread_info_t* current_thread_info() {
   return &thread_infos[get_cpu()];
@@ -61,11 +61,11 @@ void run_on_cpus(async_fn_t* fn, void* arg) {
 
   fail_on(IN_STACK_MMAP_SPACE((u64)arg), "cannot pass run_on_cpus a stack-local arg.");
 
-  for (int i = 0; i < 4; i++)
+  for (int i = 0; i < NO_CPUS; i++)
     while (!cpu_data[i].started)
       wfe();
 
-  for (int i = 0; i < 4; i++) {
+  for (int i = 0; i < NO_CPUS; i++) {
     if (i != cur_cpu) {
       run_on_cpu_async(i, fn, arg);
     }
@@ -75,7 +75,7 @@ void run_on_cpus(async_fn_t* fn, void* arg) {
   cpu_data[cur_cpu].finished = 1;
   sev();
   sevl();
-  for (int i = 0; i < 4; i++) {
+  for (int i = 0; i < NO_CPUS; i++) {
     while (!cpu_data[i].finished)
       wfe();
   }
@@ -43,13 +43,14 @@ u64* TESTDATA_MMAP;
 
 u64 BOT_OF_TESTDATA;
 u64 TOP_OF_TESTDATA;
+u64 NO_TESTDATA_REGIONS;
 
 u64 vector_base_pa;
 
 boot_data_t boot_data;
 
 void init_device(void* fdt) {
-  NO_CPUS = 4;
+  NO_CPUS = dtb_read_no_cpus(fdt);
   init_driver();
 
   /* read the memory region from the dtb */
@@ -75,11 +76,11 @@ void init_device(void* fdt) {
      *    |
      *    |       PAGETABLE ALLOC REGION
      *    |
-     *  ------- 4k
+     *  ~~~~~~~~ 2M
      *    |
      *    |       HEAP
      *    |
-     *  ------- 4k
+     *  ~~~~~~~~ 2M
      *    |
      *    |       STACK
      *    |
@@ -92,29 +93,35 @@ void init_device(void* fdt) {
      *  ------- BOT
      *
      * by fitting things onto 2M regions we reduce the number of entries the pagetable requires
+     * every region from the stack up is a whole number of 2M blocks, whatever the size of DRAM,
+     * so the harness maps them all with block entries.
+     * only text and data, whose load address we do not control, may need 4k pages.
      */
 
   u64 end_of_loaded_sections = (u64)&__ld_end_sections;
 
   /* we align the stack up to the nearest 2M */
   BOT_OF_STACK_PA = ALIGN_UP(end_of_loaded_sections, PMD_SHIFT);
-  TOP_OF_STACK_PA = BOT_OF_STACK_PA + 2 * MAX_CPUS * STACK_SIZE;
+  TOP_OF_STACK_PA = BOT_OF_STACK_PA + 2 * NO_CPUS * STACK_SIZE;
 
   /* we allocate between 12.5% of DRAM up to 64 MiB max for heap space */
   TOTAL_HEAP = MIN(64 * MiB, ((TOP_OF_MEM - BOT_OF_MEM) / 8));
   BOT_OF_HEAP = TOP_OF_STACK_PA;
-  TOP_OF_HEAP = BOT_OF_HEAP + ALIGN_UP(TOTAL_HEAP, PAGE_SHIFT);
+  TOP_OF_HEAP = BOT_OF_HEAP + ALIGN_UP(TOTAL_HEAP, PMD_SHIFT);
 
   /* we then allocate up to 32 MiB for the pagetables */
   TOTAL_TABLE_SPACE = MIN(32 * MiB, ((TOP_OF_MEM - BOT_OF_MEM) / 8));
   BOT_OF_PTABLES = TOP_OF_HEAP;
-  TOP_OF_PTABLES = BOT_OF_PTABLES + ALIGN_UP(TOTAL_TABLE_SPACE, PAGE_SHIFT);
+  TOP_OF_PTABLES = BOT_OF_PTABLES + ALIGN_UP(TOTAL_TABLE_SPACE, PMD_SHIFT);
 
   /* finally we allocate whatever is left for the actual test data variables
      */
   BOT_OF_TESTDATA = ALIGN_UP(TOP_OF_PTABLES, PMD_SHIFT);
   TOP_OF_TESTDATA = TOP_OF_MEM;
 
+  /* as many of the test data regions as there is physical memory for */
+  NO_TESTDATA_REGIONS = MIN(NR_REGIONS, (TOP_OF_TESTDATA - BOT_OF_TESTDATA) / REGION_SIZE);
+
   HARNESS_MMAP = (u64*)(64 * GiB);
   TESTDATA_MMAP = (u64*)(128 * GiB);
 
@@ -577,30 +584,54 @@ void dtb_check_psci(char* fdt) {
   }
 }
 
-void dtb_read_cpu_enable(char* fdt) {
+/** find the cpu@N node under /cpus
+ */
+static fdt_structure_begin_node_header* dtb_read_cpu_node(char* fdt, fdt_structure_begin_node_header* cpus, u64 cpu) {
+  char name[32];
+  sprintf(NEW_BUFFER(name, 32), "cpu@%ld", cpu);
+  return fdt_read_node(fdt, cpus, name);
+}
+
+u64 dtb_read_no_cpus(void* fdt) {
   if (fdt == NULL) {
-    /* assume PSCI if no DTB */
-    boot_data.kind = BOOT_KIND_PSCI;
-    return;
+    /* if no DTB, assume rpi3 */
+    return 4;
   }
 
   fdt_structure_begin_node_header* cpus = fdt_find_node(fdt, "cpus");
+  if (cpus == NULL) {
+    fail("Malformed dtb: no cpus node\n");
+  }
 
-  fdt_structure_begin_node_header* cpu0 = fdt_read_node(fdt, cpus, "cpu@0");
-  fdt_structure_begin_node_header* cpu1 = fdt_read_node(fdt, cpus, "cpu@1");
-  fdt_structure_begin_node_header* cpu2 = fdt_read_node(fdt, cpus, "cpu@2");
-  fdt_structure_begin_node_header* cpu3 = fdt_read_node(fdt, cpus, "cpu@3");
+  u64 no_cpus = 0;
+  while (no_cpus < MAX_CPUS && dtb_read_cpu_node(fdt, cpus, no_cpus) != NULL) {
+    no_cpus++;
+  }
 
-  if (cpu0 == NULL) {
+  if (no_cpus == 0) {
     fail("Malformed dtb: no cpu@0 node\n");
-  } else if (cpu1 == NULL) {
-    fail("FDT: Could not find CPU 1.\n");
-  } else if (cpu2 == NULL) {
-    fail("FDT: Could not find CPU 2.\n");
-  } else if (cpu3 == NULL) {
-    fail("FDT: Could not find CPU 3.\n");
   }
 
+  if (no_cpus == MAX_CPUS && dtb_read_cpu_node(fdt, cpus, MAX_CPUS) != NULL) {
+    warning(WARN_ALWAYS, "FDT: more than %ld CPUs, only using the first %ld. (rebuild with MAX_CPUS=N)\n", MAX_CPUS, MAX_CPUS);
+  }
+
+  return no_cpus;
+}
+
+void dtb_read_cpu_enable(char* fdt) {
+  if (fdt == NULL) {
+    /* assume PSCI if no DTB */
+    boot_data.kind = BOOT_KIND_PSCI;
+    for (u64 cpu = 0; cpu < NO_CPUS; cpu++) {
+      boot_data.mpidr[cpu] = CPU_TO_MPIDR(cpu);
+    }
+    return;
+  }
+
+  fdt_structure_begin_node_header* cpus = fdt_find_node(fdt, "cpus");
+  fdt_structure_begin_node_header* cpu0 = dtb_read_cpu_node(fdt, cpus, 0);
+
   fdt_structure_property_header* cpu0_enable = fdt_read_prop(fdt, cpu0, "enable-method");
   if (cpu0_enable == NULL) {
     fail("FDT: CPU0 did not have an enable-method property.\n");
@@ -611,22 +642,44 @@ void dtb_read_cpu_enable(char* fdt) {
     boot_data.kind = BOOT_KIND_PSCI;
   } else if (strcmp(cpu0_enable->data, "spin-table")) {
     DDEBUG("Using SPIN-TABLE to boot\n");
-
     boot_data.kind = BOOT_KIND_SPIN;
-    fdt_structure_property_header* cpu0_rel_addr = fdt_read_prop(fdt, cpu0, "cpu-release-addr");
-    fdt_structure_property_header* cpu1_rel_addr = fdt_read_prop(fdt, cpu1, "cpu-release-addr");
-    fdt_structure_property_header* cpu2_rel_addr = fdt_read_prop(fdt, cpu2, "cpu-release-addr");
-    fdt_structure_property_header* cpu3_rel_addr = fdt_read_prop(fdt, cpu3, "cpu-release-addr");
-
-    DDEBUG("CPU release-addr(s)  : %p %p %p %p\n", cpu0_rel_addr, cpu1_rel_addr, cpu2_rel_addr, cpu3_rel_addr);
-
-    boot_data.spin_base[0] = read_be64(cpu0_rel_addr->data);
-    boot_data.spin_base[1] = read_be64(cpu1_rel_addr->data);
-    boot_data.spin_base[2] = read_be64(cpu2_rel_addr->data);
-    boot_data.spin_base[3] = read_be64(cpu3_rel_addr->data);
   } else {
     fail("FDT: (cpu@0) cpu-enable expected \"psci\" but got \"%s\"\n", cpu0_enable->data);
   }
+
+  for (u64 cpu = 0; cpu < NO_CPUS; cpu++) {
+    fdt_structure_begin_node_header* node = dtb_read_cpu_node(fdt, cpus, cpu);
+    if (node == NULL) {
+      fail("FDT: Could not find CPU %ld.\n", cpu);
+    }
+
+    /* reg is the MPIDR, as either one or two cells */
+    fdt_structure_property_header* reg = fdt_read_prop(fdt, node, "reg");
+    if (reg == NULL) {
+      fail("FDT: CPU%ld did not have a reg property.\n", cpu);
+    }
+
+    u32 len = read_be((char*)&reg->len);
+    u64 mpidr = (len == 8) ? read_be64(reg->data) : read_be(reg->data);
+
+    /* the harness numbers CPUs by their MPIDR (see MPIDR_TO_CPU)
+     * so the dtb must agree with that numbering */
+    if (MPIDR_TO_CPU(mpidr) != cpu) {
+      fail("FDT: cpu@%ld has MPIDR %lx, which the harness would number as CPU%ld.\n", cpu, mpidr, MPIDR_TO_CPU(mpidr));
+    }
+
+    boot_data.mpidr[cpu] = mpidr;
+
+    if (boot_data.kind == BOOT_KIND_SPIN) {
+      fdt_structure_property_header* rel_addr = fdt_read_prop(fdt, node, "cpu-release-addr");
+      if (rel_addr == NULL) {
+        fail("FDT: CPU%ld did not have a cpu-release-addr property.\n", cpu);
+      }
+
+      DDEBUG("CPU%ld release-addr : %p\n", cpu, rel_addr);
+      boot_data.spin_base[cpu] = read_be64(rel_addr->data);
+    }
+  }
 }
 
 char* dtb_bootargs(void* fdt) {
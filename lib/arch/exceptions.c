@@ -40,9 +40,9 @@ static const char* dabt_iss_dfsc[0x40] = {
  *
  * vtable[cpu][vector][EC] = *fn
  */
-exception_vector_fn* vtable[4][4][64] = { NULL };
-exception_vector_fn* vtable_svc[4][64] = { NULL }; /* 64 SVC handlers */
-exception_vector_fn* vtable_pgfault[4][128] = { NULL };
+exception_vector_fn* vtable[MAX_CPUS][4][64] = { NULL };
+exception_vector_fn* vtable_svc[MAX_CPUS][64] = { NULL }; /* 64 SVC handlers */
+exception_vector_fn* vtable_pgfault[MAX_CPUS][128] = { NULL };
 
 /* a buffer to write exception messages into
  * protected by _EXC_PRINT_LOCK
@@ -14,6 +14,9 @@ u8 arch_feature_version(enum arm_feature id) {
     return BIT_SLICE(DFR0, DFR0_FIELD_TraceVer);
   case FEAT_LSE:
     return BIT_SLICE(ISAR0, ISAR0_FIELD_ATOMIC);
+  case FEAT_TLBIRANGE:
+    /* 0b0001 is just FEAT_TLBIOS, 0b0010 is FEAT_TLBIOS and FEAT_TLBIRANGE */
+    return BIT_SLICE(ISAR0, ISAR0_FIELD_TLB) >= 2 ? 1 : 0;
   default:
     unreachable();
   }
@@ -26,6 +29,7 @@ void arch_read_feature_matrix(struct arch_feature_matrix* m_out) {
   m_out->features[FEAT_PMUv3] = arch_feature_version(FEAT_PMUv3);
   m_out->features[FEAT_TRBE] = arch_feature_version(FEAT_TRBE);
   m_out->features[FEAT_LSE] = arch_feature_version(FEAT_LSE);
+  m_out->features[FEAT_TLBIRANGE] = arch_feature_version(FEAT_TLBIRANGE);
 }
 
 bool arch_has_feature(enum arm_feature id) {
@@ -0,0 +1,140 @@
+#include "lib.h"
+
+typedef struct
+{
+  const char* name;
+  u64 event;
+} pmu_event_name_t;
+
+/* the PMUv3 common architectural and microarchitectural events
+ * see the Arm ARM D11.11 "PMU events and event numbers" */
+static const pmu_event_name_t pmu_event_names[] = {
+  { "sw_incr", 0x00 },        { "l1i_refill", 0x01 },      { "l1i_tlb_refill", 0x02 },
+  { "l1d_refill", 0x03 },     { "l1d_cache", 0x04 },       { "l1d_tlb_refill", 0x05 },
+  { "ld_retired", 0x06 },     { "st_retired", 0x07 },      { "inst_retired", 0x08 },
+  { "exc_taken", 0x09 },      { "exc_return", 0x0A },      { "br_mis_pred", 0x10 },
+  { "cpu_cycles", 0x11 },     { "mem_access", 0x13 },      { "l1i_cache", 0x14 },
+  { "l2d_cache", 0x16 },      { "l2d_refill", 0x17 },      { "bus_access", 0x19 },
+  { "stall_frontend", 0x23 }, { "stall_backend", 0x24 },   { "l1d_tlb", 0x25 },
+  { "l2d_tlb_refill", 0x2D }, { "l2d_tlb", 0x2F },         { "dtlb_walk", 0x34 },
+  { "itlb_walk", 0x35 },      { "ll_cache_miss_rd", 0x37 }, { NULL, 0 },
+};
+
+u64 pmu_event_from_str(char* name) {
+  if (strstartswith(name, "0x")) {
+    /* event numbers are 16 bits */
+    u64 event = 0;
+    u64 no_digits = 0;
+    for (char* c = name + 2; *c != '\0'; c++, no_digits++) {
+      u64 digit;
+      if (*c >= '0' && *c <= '9')
+        digit = *c - '0';
+      else if (*c >= 'a' && *c <= 'f')
+        digit = *c - 'a' + 10;
+      else if (*c >= 'A' && *c <= 'F')
+        digit = *c - 'A' + 10;
+      else
+        return PMU_EVENT_UNKNOWN;
+
+      if (event > 0xfff)
+        return PMU_EVENT_UNKNOWN;
+
+      event = (event << 4) | digit;
+    }
+
+    return no_digits == 0 ? PMU_EVENT_UNKNOWN : event;
+  }
+
+  for (const pmu_event_name_t* e = &pmu_event_names[0]; e->name != NULL; e++) {
+    if (strcmp(name, e->name))
+      return e->event;
+  }
+
+  return PMU_EVENT_UNKNOWN;
+}
+
+const char* pmu_event_to_str(u64 event) {
+  for (const pmu_event_name_t* e = &pmu_event_names[0]; e->name != NULL; e++) {
+    if (e->event == event)
+      return e->name;
+  }
+
+  return NULL;
+}
+
+void sprint_pmu_event(STREAM* out, u64 event) {
+  const char* name = pmu_event_to_str(event);
+  if (name != NULL)
+    sprintf(out, "%s", name);
+  else
+    sprintf(out, "0x%lx", event);
+}
+
+u64 pmu_no_counters(void) {
+  return (read_sysreg(pmcr_el0) >> 11) & 0x1f;
+}
+
+/* the PMEVTYPER<n>_EL0 and PMEVCNTR<n>_EL0 registers can only be named statically */
+static void write_evtyper(u64 n, u64 val) {
+  switch (n) {
+  case 0:
+    write_sysreg(val, pmevtyper0_el0);
+    break;
+  case 1:
+    write_sysreg(val, pmevtyper1_el0);
+    break;
+  case 2:
+    write_sysreg(val, pmevtyper2_el0);
+    break;
+  case 3:
+    write_sysreg(val, pmevtyper3_el0);
+    break;
+  case 4:
+    write_sysreg(val, pmevtyper4_el0);
+    break;
+  case 5:
+    write_sysreg(val, pmevtyper5_el0);
+    break;
+  default:
+    fail("write_evtyper: no such counter %ld\n", n);
+  }
+}
+
+static u64 read_evcntr(u64 n) {
+  switch (n) {
+  case 0:
+    return read_sysreg(pmevcntr0_el0);
+  case 1:
+    return read_sysreg(pmevcntr1_el0);
+  case 2:
+    return read_sysreg(pmevcntr2_el0);
+  case 3:
+    return read_sysreg(pmevcntr3_el0);
+  case 4:
+    return read_sysreg(pmevcntr4_el0);
+  case 5:
+    return read_sysreg(pmevcntr5_el0);
+  default:
+    return 0;
+  }
+}
+
+void pmu_program_events(u64* events, u64 n) {
+  u64 mask = 0;
+
+  for (u64 i = 0; i < n; i++) {
+    /* P=U=0 counts at EL1 and EL0, NSH=0 ignores EL2 */
+    write_evtyper(i, events[i] & 0xffff);
+    mask |= 1UL << i;
+  }
+
+  write_sysreg(mask, pmcntenset_el0);
+  isb();
+}
+
+void pmu_read_events(u64* out, u64 n) {
+  isb();
+  for (u64 i = 0; i < n; i++) {
+    out[i] = read_evcntr(i);
+  }
+}
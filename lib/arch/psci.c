@@ -10,7 +10,7 @@ void __psci_invoke(u64 func, u64 x1, u64 x2, u64 x3) {
 }
 
 void psci_cpu_on(u64 cpu) {
-  __psci_invoke(PSCI_CPU_ON, cpu, (u64)cpu_entry, 0);
+  __psci_invoke(PSCI_CPU_ON, boot_data.mpidr[cpu], (u64)cpu_entry, 0);
 }
 
 void psci_system_off(void) {
@@ -133,6 +133,31 @@ static void __atomic_dec(volatile u64* va) {
   );
 }
 
+static u64 __atomic_inc_return(volatile u64* va) {
+  /* atomic increment
+   * returning the new value
+   *
+   * unlike __atomic_cas/__atomic_dec this does not wait for an event
+   * or barrier inside the exclusive loop,  the acquire/release pair
+   * is enough to order it with the surrounding accesses.
+   */
+  u64 v;
+  asm volatile(
+    "0:\n"
+    "ldaxr %[v], [%[va]]\n"
+    "add %[v], %[v], #1\n"
+    "stlxr w1, %[v], [%[va]]\n"
+    /*
+     * try again if another thread intervened
+     */
+    "cbnz w1, 0b\n"
+    : [v] "=&r"(v)
+    : [va] "r"(va)
+    : "memory", "x1"
+  );
+  return v;
+}
+
 /** arm64 atomic lock
  */
 
@@ -162,11 +187,7 @@ void mutex_unlock(volatile mutex_t* mut) {
 
 lock_t bwait_lock;
 
-void bwait(int vcpu, bar_t* bar, int sz) {
-  if (!current_thread_info()->locking_enabled) {
-    fail("bwait needs locking enabled\n");
-  }
-
+static void bwait_locked(int vcpu, bar_t* bar, int sz) {
   /* slow acquire */
   LOCK(&bwait_lock);
 
@@ -223,4 +244,44 @@ void bwait(int vcpu, bar_t* bar, int sz) {
    */
   while (bar->iteration == iter && bar->waiting != 0)
     dmb();
-}
\ No newline at end of file
+}
+
+/** lock-free sense-reversing barrier
+ *
+ * each arrival atomically increments bar->arrived,
+ * the last to arrive resets the counter and advances bar->epoch
+ * releasing everyone spinning on the old epoch.
+ *
+ * the epoch cannot advance until this thread has arrived,
+ * so it is safe to sample it before incrementing the counter.
+ * and no thread can re-arrive at this barrier until the epoch has advanced,
+ * so the reset of the counter cannot race with the next round.
+ */
+static void bwait_lockfree(int vcpu, bar_t* bar, int sz) {
+  u64 epoch = bar->epoch;
+
+  if (__atomic_inc_return(&bar->arrived) == sz) {
+    bar->arrived = 0;
+    write_release(&bar->epoch, epoch + 1);
+    dsb();
+    sev();
+  } else {
+    while (bar->epoch == epoch)
+      wfe();
+  }
+
+  dmb();
+}
+
+void bwait(int vcpu, bar_t* bar, int sz) {
+  if (!current_thread_info()->locking_enabled) {
+    fail("bwait needs locking enabled\n");
+  }
+
+  /* exclusives are only safe once the MMU is on
+   * so fall back to the locked (lamport) implementation before that */
+  if (BARRIER_TYPE == BARRIER_LOCKFREE && ENABLE_PGTABLE)
+    bwait_lockfree(vcpu, bar, sz);
+  else
+    bwait_locked(vcpu, bar, sz);
+}
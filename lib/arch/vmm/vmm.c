@@ -15,6 +15,8 @@ lock_t _vmm_lock;
 void vmm_update_pte(u64* pte, u64 new_val, sync_type_t sync_kind, u64 asid_or_va, bool force) {
   bool needs_tlb_maintenance = force;
 
+  vmm_walk_cache_note_write(pte, *pte, new_val);
+
   if (*pte > 0) {
     write_release(pte, 0);
     needs_tlb_maintenance = true;
@@ -39,6 +41,90 @@ void vmm_update_pte(u64* pte, u64 new_val, sync_type_t sync_kind, u64 asid_or_va
   }
 }
 
+void vmm_begin_pte_batch(vmm_pte_batch_t* batch, sync_type_t sync_kind, u64 asid) {
+  batch->sync_kind = sync_kind;
+  batch->asid = asid;
+  batch->no_updates = 0;
+}
+
+void vmm_batch_update_pte(vmm_pte_batch_t* batch, u64* pte, u64 new_val, u64 va) {
+  if (batch->no_updates == VMM_PTE_BATCH_SIZE)
+    vmm_commit_pte_batch(batch);
+
+  batch->updates[batch->no_updates++] = (vmm_pte_update_t){ pte, new_val, va };
+}
+
+/* invalidate the VAs of the updates which broke a valid entry */
+static void tlbi_batch_vas(vmm_pte_batch_t* batch, bool* broken, u64 no_broken) {
+  u64 va_min = ~0UL;
+  u64 va_max = 0;
+
+  for (u64 i = 0; i < batch->no_updates; i++) {
+    if (broken[i]) {
+      va_min = MIN(va_min, batch->updates[i].va);
+      va_max = MAX(va_max, batch->updates[i].va);
+    }
+  }
+
+  if (no_broken > 1 && arch_has_feature(FEAT_TLBIRANGE)) {
+    u64 no_pages = ((va_max - va_min) >> PAGE_SHIFT) + 1;
+    if (tlbi_va_range(va_min, no_pages))
+      return;
+  }
+
+  for (u64 i = 0; i < batch->no_updates; i++) {
+    if (broken[i])
+      tlbi_va(batch->updates[i].va);
+  }
+}
+
+void vmm_commit_pte_batch(vmm_pte_batch_t* batch) {
+  bool broken[VMM_PTE_BATCH_SIZE];
+  u64 no_broken = 0;
+
+  if (batch->no_updates == 0)
+    return;
+
+  /* break */
+  for (u64 i = 0; i < batch->no_updates; i++) {
+    u64* pte = batch->updates[i].pte;
+    vmm_walk_cache_note_write(pte, *pte, batch->updates[i].new_val);
+    /* only valid entries can be in the TLB */
+    broken[i] = batch->sync_kind != SYNC_NONE && (*pte & 1) == 1;
+
+    if (broken[i]) {
+      write_release(pte, 0);
+      no_broken++;
+    }
+  }
+
+  if (no_broken > 0) {
+    dsb();
+    if (cpu_needs_workaround(ERRATA_WORKAROUND_ISB_AFTER_PTE_ST))
+      isb();
+
+    if (batch->sync_kind == SYNC_ALL)
+      tlbi_all();
+    else if (batch->sync_kind == SYNC_ASID)
+      tlbi_asid(batch->asid);
+    else if (batch->sync_kind == SYNC_VA)
+      tlbi_batch_vas(batch, broken, no_broken);
+
+    dsb();
+  }
+
+  /* make */
+  for (u64 i = 0; i < batch->no_updates; i++) {
+    write_release(batch->updates[i].pte, batch->updates[i].new_val);
+  }
+
+  dsb();
+  if (no_broken > 0 || cpu_needs_workaround(ERRATA_WORKAROUND_ISB_AFTER_PTE_ST))
+    isb();
+
+  batch->no_updates = 0;
+}
+
 void vmm_ensure_level(u64* root, int desired_level, u64 va) {
   desc_t block_desc = { .level = 0 };
 
@@ -59,6 +145,19 @@ void vmm_ensure_level(u64* root, int desired_level, u64 va) {
 
     if (desc.type == Table) {
       current = (u64*)desc.table_addr;
+
+      /* the subtable may still be shared with the template
+       * so take a private copy before anything in it can change.
+       * the copy is identical, so there is nothing to invalidate
+       */
+      if (vmm_table_is_shared(current)) {
+        u64* copy = zalloc_ptable();
+        valloc_memcpy(copy, current, PAGE_SIZE);
+        DEBUG(DEBUG_TRACE_VMM_ENSURES, "copy shared level%d table %p to %p\n", level + 1, current, copy);
+        vmm_update_pte(p, (*p & ~desc.table_addr) | (u64)copy, SYNC_NONE, 0, false);
+        current = copy;
+      }
+
       continue;
     }
 
@@ -154,6 +253,19 @@ int vmm_level(u64* root, u64 va) {
 }
 
 u64* vmm_desc_at_level(u64* root, u64 va, int ensure_level, int desc_level) {
+  /* once a walk is made all the way to level 3, the tables on the way can be cached */
+  if (ensure_level == 3) {
+    u64** tables = vmm_walk_cache_lookup(root, va);
+
+    if (tables == NULL) {
+      vmm_ensure_level(root, ensure_level, va);
+      tables = vmm_walk_cache_fill(root, va);
+    }
+
+    if (tables != NULL)
+      return tables[desc_level] + OFFS(va, desc_level);
+  }
+
   vmm_ensure_level(root, ensure_level, va);
   desc_t desc = vmm_translation_walk_to_level(root, va, desc_level);
   fail_on(!desc.src.has_src, "bug: desc should have source");
@@ -175,7 +287,13 @@ attrs_t vmm_read_attrs(u64* root, u64 va) {
 }
 
 u64* vmm_pa(u64* root, u64 va) {
-  desc_t desc = vmm_translation_walk(root, va);
+  desc_t desc;
+  u64** tables = vmm_walk_cache_lookup(root, va);
+
+  if (tables != NULL)
+    desc = read_desc(tables[3][OFFS(va, 3)], 3);
+  else
+    desc = vmm_translation_walk(root, va);
 
   switch (desc.type) {
   case Invalid:
@@ -93,7 +93,7 @@ u64 vmm_make_desc(u64 pa, u64 prot, int level) {
   final.oa = pa;
   final.level = level;
   final.attrs = read_attrs(prot);
-  final.attrs.nG = PROT_NG_NOT_GLOBAL;
+  final.attrs.nG = (prot & PROT_GLOBAL) ? 0 : PROT_NG_NOT_GLOBAL;
   final.attrs.AF = PROT_AF_ACCESS_FLAG_DISABLE;
   final.attrs.SH = PROT_SH_ISH;
   final.attrs.NS = PROT_NS_NON_SECURE;
@@ -228,6 +228,24 @@ const char* VMRegionTag_names[] = {
   "VM_TESTDATA", "VM_MMAP_HARNESS", "VM_MMAP_STACK_EL0", "VM_MMAP_STACK_EL1", "VM_MMAP_VTABLE",
 };
 
+/** whether the region is mapped the same in every table, harness or test,
+ * and so can be mapped with global entries
+ */
+static bool vmregion_is_harness_invariant(VMRegionTag tag) {
+  switch (tag) {
+  case VM_MMAP_IO:
+  case VM_TEXT:
+  case VM_DATA:
+  case VM_STACK:
+  case VM_HEAP:
+  case VM_PTABLES:
+  case VM_MMAP_HARNESS:
+    return true;
+  default:
+    return false;
+  }
+}
+
 static void update_table_from_vmregion_map(u64* table, VMRegions regs) {
   VMRegion* map = regs.regions;
 
@@ -244,6 +262,9 @@ static void update_table_from_vmregion_map(u64* table, VMRegions regs) {
     else if (r.va_start < r_prev.va_start)
       fail("! %o's region comes after a later region %o\n", r, r_prev);
 
+    if (ENABLE_GLOBAL_HARNESS && vmregion_is_harness_invariant(i))
+      r.prot |= PROT_GLOBAL;
+
     debug("map [%s] %p -> %p\n", VMRegionTag_names[i], r.va_start, r.va_end);
     vmm_ptable_map(table, r);
   }
@@ -416,7 +437,7 @@ static u64* __vmm_alloc_table(u8 is_test) {
    * physical address space TOP_OF_HEAP -> TOP_OF_MEM but with
    * a virtual address space placed after RAM_END
    *
-   * we allocate 16 x 8M contiguous regions
+   * we allocate up to NR_REGIONS x 8M contiguous regions
    * but spread evenly throughout a 64G VA space located at 128G
    *
    * we don't actually allocate it here
@@ -447,8 +468,46 @@ u64* vmm_alloc_new_4k_pgtable(void) {
   return ptable;
 }
 
+/** the table each test pgtable starts as a copy of
+ *
+ * its subtables are all allocated together, between template_bot and template_top,
+ * and are shared read-only by all the test pgtables until vmm_ensure_level copies them.
+ */
+static u64* test_pgtable_template = NULL;
+static u64 template_bot = 0;
+static u64 template_top = 0;
+
+void vmm_alloc_test_pgtable_template(void) {
+  valloc_ptable_mem before = valloc_ptable_checkpoint();
+  u64* template = __vmm_alloc_table(1);
+  valloc_ptable_mem after = valloc_ptable_checkpoint();
+
+  /* only now is it shared, so building it did not copy its own tables */
+  template_bot = before.bot;
+  template_top = after.bot;
+  test_pgtable_template = template;
+
+  debug(
+    "allocated test pgtable template rooted at %p with %ld tables\n",
+    template,
+    (template_top - template_bot) / PAGE_SIZE
+  );
+}
+
+bool vmm_table_is_shared(u64* table) {
+  return template_bot <= (u64)table && (u64)table < template_top;
+}
+
 u64* vmm_alloc_new_test_pgtable(void) {
-  u64* ptable = __vmm_alloc_table(1);
+  u64* ptable;
+
+  if (test_pgtable_template != NULL) {
+    ptable = zalloc_ptable();
+    valloc_memcpy(ptable, test_pgtable_template, PAGE_SIZE);
+  } else {
+    ptable = __vmm_alloc_table(1);
+  }
+
   debug("allocated new test pgtable rooted at %p\n", ptable);
   DEBUG(DEBUG_PTABLE, "ptable @ %p has %ld nested tables\n", ptable, vmm_count_subtables(ptable));
   return ptable;
@@ -467,6 +526,18 @@ static void set_new_ttable(u64 ttbr, u64 tcr, u64 mair) {
   vmm_mmu_on();
 }
 
+/** the table the hardware starts its walk from
+ *
+ * the tables are always built with 4 levels,
+ * but with a smaller VA space the walk starts at the level 1 table of the bottom 512G
+ */
+static u64 hw_root(u64* pgtable) {
+  if (VMM_START_LEVEL == 1)
+    return read_desc(pgtable[0], 0).table_addr;
+
+  return (u64)pgtable;
+}
+
 void vmm_set_id_translation(u64* pgtable) {
   if (pgtable == NULL) {
     vmm_mmu_off();
@@ -475,20 +546,25 @@ void vmm_set_id_translation(u64* pgtable) {
 
   /* now set the new TTBR and TCR */
   u64 asid = 0;
-  u64 ttbr = MK_TTBR(pgtable, asid);
+  u64 ttbr = MK_TTBR(hw_root(pgtable), asid);
+  u64 t0sz = 64 - VA_BITS;
 
   /* clang-format off */
+  u64 as = ASID_SIZE == 16 ? 1 : 0;
+
   u64 tcr = \
     0          |
     (0L << 39) |  /* HA, software access flag */
     (1L << 37) |  /* TBI, top byte ignored. */
+    (as << 36) |  /* AS, 16-bit ASIDs if supported. */
     (5L << 32) |  /* IPS, 48-bit (I)PA. */
     (0 << 14)  |  /* TG0, granule size, 4K. */
     (3 << 12)  |  /* SH0, inner shareable. */
     (1 << 10)  |  /* ORGN0, normal mem, WB RA WA Cacheable. */
     (1 << 8)   |  /* IRGN0, normal mem, WB RA WA Cacheable. */
-    (16 << 0)  ;  /* T0SZ, input address is 48 bits => VA[47:12] are
-                      used for  translation starting at level 0. */
+    (t0sz << 0);  /* T0SZ, input address is VA_BITS bits,
+                      48 bits => VA[47:12] are used for translation starting at level 0,
+                      39 bits => VA[38:12] are used for translation starting at level 1. */
 
 
   #define MAIR_ATTR(idx, attr)  ((attr) << (idx*8))
@@ -518,7 +594,7 @@ static void __vmm_switch_table(u64 new_table, u64 asid) {
 }
 
 void vmm_switch_ttable(u64* new_table) {
-  __vmm_switch_table((u64)new_table, 0);
+  __vmm_switch_table(hw_root(new_table), 0);
 }
 
 void vmm_switch_asid(u64 asid) {
@@ -528,7 +604,7 @@ void vmm_switch_asid(u64 asid) {
 }
 
 void vmm_switch_ttable_asid(u64* new_table, u64 asid) {
-  __vmm_switch_table((u64)new_table, asid);
+  __vmm_switch_table(hw_root(new_table), asid);
 }
 
 static void _vmm_walk_table(u64* pgtable, int level, u64 va_start, walker_cb_t* cb_f, void* data) {
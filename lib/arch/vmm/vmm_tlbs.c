@@ -1,33 +1,79 @@
 
 #include "lib.h"
 
+/* number of TLBIs each CPU has issued */
+static u64 tlbi_counts[MAX_CPUS];
+
 void tlbi_va(u64 va) {
   u64 page = va >> 12;
   asm volatile("tlbi vaae1is, %[va]\n" : : [va] "r"(page) : "memory");
+  tlbi_counts[get_cpu()]++;
 
   if (cpu_needs_workaround(ERRATA_WORKAROUND_REPEAT_TLBI)) {
     dsb();
     asm volatile("tlbi vaae1is, %[va]\n" : : [va] "r"(page) : "memory");
+    tlbi_counts[get_cpu()]++;
   }
 }
 
 void tlbi_asid(u64 asid) {
-  u64 reg = (asid & 0xff) << 48;
+  u64 reg = (asid & MAX_ASID) << 48;
   asm volatile("tlbi aside1is, %[asid]\n" : : [asid] "r"(reg) : "memory");
+  tlbi_counts[get_cpu()]++;
 
   if (cpu_needs_workaround(ERRATA_WORKAROUND_REPEAT_TLBI)) {
     dsb();
     asm volatile("tlbi aside1is, %[asid]\n" : : [asid] "r"(reg) : "memory");
+    tlbi_counts[get_cpu()]++;
   }
 }
 
 void tlbi_all(void) {
   asm volatile("tlbi vmalle1is\n" ::: "memory");
+  tlbi_counts[get_cpu()]++;
 
   if (cpu_needs_workaround(ERRATA_WORKAROUND_REPEAT_TLBI)) {
     dsb();
     asm volatile("tlbi vmalle1is\n" ::: "memory");
+    tlbi_counts[get_cpu()]++;
+  }
+}
+
+/* the number of pages a TLBI by range with the given SCALE and NUM invalidates */
+#define TLBI_RANGE_PAGES(scale, num) (((u64)(num) + 1) << (5 * (scale) + 1))
+
+bool tlbi_va_range(u64 va, u64 no_pages) {
+  for (u64 scale = 0; scale < 4; scale++) {
+    if (no_pages <= TLBI_RANGE_PAGES(scale, 31)) {
+      u64 unit = TLBI_RANGE_PAGES(scale, 0);
+      u64 num = (no_pages + unit - 1) / unit - 1;
+
+      /* TG=0b01 (4K), TTL=0 (any level) */
+      u64 reg = (1UL << 46) | (scale << 44) | (num << 39) | ((va >> 12) & BITMASK(37));
+
+      /* tlbi rvaae1is, but as a sys so it assembles without +tlb-rmi */
+      asm volatile("sys #0, c8, c2, #3, %[reg]\n" : : [reg] "r"(reg) : "memory");
+      tlbi_counts[get_cpu()]++;
+
+      if (cpu_needs_workaround(ERRATA_WORKAROUND_REPEAT_TLBI)) {
+        dsb();
+        asm volatile("sys #0, c8, c2, #3, %[reg]\n" : : [reg] "r"(reg) : "memory");
+        tlbi_counts[get_cpu()]++;
+      }
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+u64 tlbi_count(void) {
+  u64 total = 0;
+  for (u64 cpu = 0; cpu < NO_CPUS; cpu++) {
+    total += tlbi_counts[cpu];
   }
+  return total;
 }
 
 void vmm_flush_tlb_vaddr(u64 va) {
@@ -0,0 +1,125 @@
+#include "lib.h"
+
+/** a per-CPU cache of translation table walks
+ *
+ * each entry is the path of tables from a root down to the level 3 table
+ * which maps one 2M region, so finding the entry for any VA in that region
+ * does not need a walk from the root (or the lock in vmm_ensure_level).
+ *
+ * entries are only made for complete paths, after vmm_ensure_level,
+ * and a path stays the same unless a valid entry in one of its level 0-2 tables is overwritten
+ * (which vmm_update_pte and vmm_commit_pte_batch tell us about)
+ * or the pagetable space is reset (valloc_ptable_restore).
+ * either flushes all the CPUs' caches, by starting a new generation.
+ */
+
+#define WALK_CACHE_SIZE 64
+
+/* the most pagetables there can be, see TOTAL_TABLE_SPACE */
+#define WALK_CACHE_MAX_TABLES ((32 * MiB) / PAGE_SIZE)
+
+typedef struct
+{
+  u64* root;
+  u64 region; /* va >> 21 */
+  u64 generation;
+  u64* tables[4];
+} walk_cache_entry_t;
+
+static walk_cache_entry_t walk_caches[MAX_CPUS][WALK_CACHE_SIZE];
+static volatile u64 walk_cache_generation = 1;
+
+/* one bit for each page of pagetable space
+ * set if it is a level 0-2 table of some cached path */
+static u64 upper_tables[WALK_CACHE_MAX_TABLES / 64];
+
+/* the CPUs fill their caches at the same time when they initialise a batch together,
+ * so setting a bit (or starting a new generation) must not lose another CPU's update */
+static lock_t walk_cache_lock;
+
+static bool table_index(u64* table, u64* ix) {
+  if ((u64)table < BOT_OF_PTABLES || (u64)table >= TOP_OF_PTABLES)
+    return false;
+
+  *ix = ((u64)table - BOT_OF_PTABLES) / PAGE_SIZE;
+  return *ix < WALK_CACHE_MAX_TABLES;
+}
+
+static void mark_upper_table(u64* table) {
+  u64 ix;
+  if (!table_index(table, &ix))
+    return;
+
+  /* most tables are already marked, so only take the lock to set a new bit */
+  u64 bit = 1UL << (ix % 64);
+  if (upper_tables[ix / 64] & bit)
+    return;
+
+  LOCK(&walk_cache_lock);
+  upper_tables[ix / 64] |= bit;
+  UNLOCK(&walk_cache_lock);
+}
+
+static bool is_upper_table(u64* table) {
+  u64 ix;
+  if (!table_index(table, &ix))
+    return false;
+
+  return (upper_tables[ix / 64] >> (ix % 64)) & 1;
+}
+
+static walk_cache_entry_t* walk_cache_entry(u64* root, u64 va) {
+  u64 region = va >> 21;
+  u64 h = (region ^ ((u64)root >> 12)) % WALK_CACHE_SIZE;
+  return &walk_caches[get_cpu()][h];
+}
+
+u64** vmm_walk_cache_lookup(u64* root, u64 va) {
+  walk_cache_entry_t* e = walk_cache_entry(root, va);
+
+  if (e->generation == walk_cache_generation && e->root == root && e->region == va >> 21)
+    return e->tables;
+
+  return NULL;
+}
+
+u64** vmm_walk_cache_fill(u64* root, u64 va) {
+  walk_cache_entry_t* e = walk_cache_entry(root, va);
+  u64 generation = walk_cache_generation;
+  u64* tables[4];
+
+  tables[0] = root;
+  for (int level = 0; level < 3; level++) {
+    desc_t desc = read_desc(tables[level][OFFS(va, level)], level);
+    if (desc.type != Table)
+      return NULL;
+
+    tables[level + 1] = (u64*)desc.table_addr;
+  }
+
+  for (int level = 0; level < 3; level++) {
+    mark_upper_table(tables[level]);
+  }
+
+  e->root = root;
+  e->region = va >> 21;
+  valloc_memcpy(e->tables, tables, sizeof(tables));
+  e->generation = generation;
+  return e->tables;
+}
+
+void vmm_walk_cache_note_write(u64* pte, u64 old_val, u64 new_val) {
+  if ((old_val & 1) == 0 || old_val == new_val)
+    return;
+
+  if (is_upper_table((u64*)ALIGN_TO((u64)pte, PAGE_SHIFT))) {
+    LOCK(&walk_cache_lock);
+    walk_cache_generation++;
+    UNLOCK(&walk_cache_lock);
+  }
+}
+
+void vmm_walk_cache_flush(void) {
+  walk_cache_generation++;
+  valloc_memset(upper_tables, 0, sizeof(upper_tables));
+}
@@ -4,10 +4,17 @@
 
 /* global configuration options + default values */
 u64 NUMBER_OF_RUNS = 10000UL;
-u64 RUNS_IN_BATCH = 1;
+u64 RUNS_IN_BATCH = 1; /* 0 = auto, pick based on the ASID size, see init_cfg_state */
 u8 ENABLE_PGTABLE = 1; /* start enabled */
 u8 ENABLE_PERF_COUNTS = 0;
 u8 RUN_FOREVER = 0;
+u8 ENABLE_PIPELINED_BATCHES = 0;
+u8 ENABLE_CPU_GROUPS = 0;
+u8 ENABLE_PROFILE = 0;
+u8 ENABLE_GLOBAL_HARNESS = 0;
+u64 VA_BITS = 48;
+u64 PMU_EVENTS[PMU_MAX_EVENTS] = { 0 };
+u64 NO_PMU_EVENTS = 0;
 
 u8 ENABLE_RESULTS_HIST = 1;
 u8 ENABLE_RESULTS_OUTREG_PRINT = 1;
@@ -40,9 +47,12 @@ u8 ENABLE_COLOUR = 1;
 
 u8 ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM = 1;
 u8 ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR = 1;
+u8 ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED = 1;
 
 output_style_t OUTPUT_FORMAT = STYLE_HERDTOOLS;
 
+barrier_type_t BARRIER_TYPE = BARRIER_LOCKFREE;
+
 char* output_style_to_str(output_style_t ty) {
   switch (ty) {
   case STYLE_HERDTOOLS:
@@ -86,6 +96,8 @@ char* shuff_type_to_str(shuffle_type_t ty) {
     return "none";
   case SHUF_RAND:
     return "rand";
+  case SHUF_FEISTEL:
+    return "feistel";
   default:
     return "unknown";
   }
@@ -99,6 +111,8 @@ char* concretize_type_to_str(concretize_type_t ty) {
     return "random";
   case CONCRETE_FIXED:
     return "fixed";
+  case CONCRETE_PLANNED:
+    return "planned";
   default:
     return "unknown";
   }
@@ -112,6 +126,19 @@ char* runner_type_to_str(litmus_runner_type_t ty) {
     return "semi";
   case RUNNER_EPHEMERAL:
     return "ephemeral";
+  case RUNNER_PIPELINED:
+    return "pipelined";
+  default:
+    return "unknown";
+  }
+}
+
+char* barrier_type_to_str(barrier_type_t ty) {
+  switch (ty) {
+  case BARRIER_LOCKFREE:
+    return "lockfree";
+  case BARRIER_LOCKED:
+    return "locked";
   default:
     return "unknown";
   }
@@ -246,8 +273,10 @@ static void device_ident_and_quit(void) {
   for (int i = 0; i < NO_CPUS; i++) {
     cpu_outs[i] = ALLOC_MANY(char*, 100);
 
+    /* one allocation per CPU, so we do not run out of alloc chunks on large machines */
+    char* lines = ALLOC_MANY(char, 100 * 1024);
     for (int j = 0; j < 100; j++) {
-      cpu_outs[i][j] = ALLOC_MANY(char, 1024);
+      cpu_outs[i][j] = &lines[j * 1024];
       cpu_outs[i][j][0] = '\0';
     }
   }
@@ -274,7 +303,7 @@ static void device_ident_and_quit(void) {
    *                      ID REGISTERS PER CPU                    <- title
    *            CPU0          CPU1            CPU2          CPU3  <- headers
    */
-  int indent_width = ((maxlinelen + 2) * 4 - 22) / 2;
+  int indent_width = ((maxlinelen + 2) * NO_CPUS - 22) / 2;
   for (int i = 0; i < indent_width; i++)
     printf(" ");
   printf(" ID REGISTERS PER CPU\n");
@@ -285,7 +314,7 @@ static void device_ident_and_quit(void) {
    *    ID0: 0x0    ID0: 0x2    ...
    *    ID1: 0x1    ID1: 0x3    ...
    */
-  for (int cpu = 0; cpu < 4; cpu++) {
+  for (int cpu = 0; cpu < NO_CPUS; cpu++) {
     for (int i = 0; i < 2 + maxlinelen - 4; i++)
       printf(" ");
 
@@ -297,7 +326,7 @@ static void device_ident_and_quit(void) {
    * underneath each header
    */
   for (int i = 0; i < 100; i++) {
-    for (int cpu = 0; cpu < 4; cpu++) {
+    for (int cpu = 0; cpu < NO_CPUS; cpu++) {
       char* line = cpu_outs[cpu][i];
 
       /* empty string means we ran off the end
@@ -323,7 +352,16 @@ static void n(char* x) {
 }
 
 static void b(char* x) {
+  if (strcmp(x, "auto")) {
+    RUNS_IN_BATCH = 0;
+    return;
+  }
+
   int Xn = atoi(x);
+  if (Xn < 1) {
+    fail("--batch-size must be at least 1, or auto, not %s\n", x);
+  }
+
   RUNS_IN_BATCH = Xn;
 }
 
@@ -332,6 +370,16 @@ static void s(char* x) {
   INITIAL_SEED = Xn;
 }
 
+static void va_bits(char* x) {
+  int Xn = atoi(x);
+
+  if (Xn < 39 || Xn > 48) {
+    fail("--va-bits must be between 39 and 48, not %s\n", x);
+  }
+
+  VA_BITS = Xn;
+}
+
 static void show(char* x) {
   display_help_show_tests();
 }
@@ -428,6 +476,46 @@ static void w(char* x) {
   } while (more);
 }
 
+static void _parse_pmu_event(char* name) {
+  if (NO_PMU_EVENTS == PMU_MAX_EVENTS)
+    fail("--pmu-events: at most %d events can be counted at once.\n", PMU_MAX_EVENTS);
+
+  u64 event = pmu_event_from_str(name);
+  if (event == PMU_EVENT_UNKNOWN)
+    fail("--pmu-events: unknown event '%s'.\n", name);
+
+  PMU_EVENTS[NO_PMU_EVENTS++] = event;
+}
+
+static void pmu_events(char* x) {
+  // comma-separated-values
+
+  char* w = x;
+  char* w_end = NULL;
+  bool more = false;
+
+  NO_PMU_EVENTS = 0;
+
+  do {
+    for (int i = 0;; i++) {
+      if (w[i] == '\0')
+        more = false;
+      else if (w[i] == ',')
+        more = true;
+      else
+        continue;
+
+      w[i] = '\0';
+      w_end = &w[i];
+      break;
+    }
+
+    _parse_pmu_event(w);
+
+    w = w_end + 1;
+  } while (more);
+}
+
 static void conc_cfg(char* x) {
   valloc_memcpy(LITMUS_CONCRETIZATION_CFG, x, strlen(x));
 }
@@ -442,7 +530,8 @@ void init_cfg_state(void) {
   /* ensure we use the correct runner for the given concretization algorithm */
   switch (LITMUS_CONCRETIZATION_TYPE) {
   case CONCRETE_RANDOM:
-    LITMUS_RUNNER_TYPE = RUNNER_EPHEMERAL;
+  case CONCRETE_PLANNED:
+    LITMUS_RUNNER_TYPE = ENABLE_PIPELINED_BATCHES ? RUNNER_PIPELINED : RUNNER_EPHEMERAL;
     break;
   case CONCRETE_LINEAR:
     LITMUS_RUNNER_TYPE = RUNNER_SEMI_ARRAY;
@@ -451,6 +540,26 @@ void init_cfg_state(void) {
     LITMUS_RUNNER_TYPE = RUNNER_EPHEMERAL;
     break;
   }
+
+  /* the pipelined runner re-concretizes each batch while the previous one is running
+   * which only the random concretizations can do without overlapping the running batch */
+  if (ENABLE_PIPELINED_BATCHES && LITMUS_RUNNER_TYPE != RUNNER_PIPELINED) {
+    fail("--pipeline requires --concretize=random or --concretize=planned\n");
+  }
+
+  /* with --batch-size=auto and 16-bit ASIDs, use large batches
+   * to spread the per-batch costs (barriers, allocations, TLB maintenance) over more runs.
+   * each run in the batch has its own pagetables, so this is limited by the space for those. */
+  if (RUNS_IN_BATCH == 0) {
+    if (ENABLE_PGTABLE && LITMUS_SYNC_TYPE == SYNC_ASID && ASID_SIZE == 16)
+      RUNS_IN_BATCH = MIN(256, NUMBER_OF_RUNS);
+    else
+      RUNS_IN_BATCH = 1;
+  }
+
+  /* the lock-free barrier uses exclusives, which are not safe with the MMU off */
+  if (!ENABLE_PGTABLE)
+    BARRIER_TYPE = BARRIER_LOCKED;
 }
 
 argdef_t COMMON_ARGS = (argdef_t){
@@ -523,6 +632,14 @@ argdef_t COMMON_ARGS = (argdef_t){
         .arg = OPT_ARG_REQUIRED,
       ),
       FLAG(NULL, "--color", ENABLE_COLOUR, "coloured log output\n"),
+      ENUMERATE(
+        "--barrier", BARRIER_TYPE, barrier_type_t, 2, ARR((const char*[]){ "lockfree", "locked" }),
+        ARR((barrier_type_t[]){ BARRIER_LOCKFREE, BARRIER_LOCKED }),
+        "type of barrier used to synchronize threads\n"
+        "\n"
+        "lockfree: atomic arrival counter and epoch flag per barrier (requires --pgtable)\n"
+        "locked: serialise every arrival through a global lock"
+      ),
       NULL,
     },
 };
@@ -542,6 +659,70 @@ argdef_t LITMUS_ARGS = (argdef_t){
       ),
       FLAG(NULL, "--run-forever", RUN_FOREVER, "repeat test runs indefinitely\n"),
       FLAG(NULL, "--perf", ENABLE_PERF_COUNTS, "enable/disable performance tests\n"),
+      FLAG(
+        NULL, "--pipeline", ENABLE_PIPELINED_BATCHES,
+        "prepare the next batch while the current one runs (default: off)\n"
+        "\n"
+        "CPUs not running a test thread concretize and write the initial state of the next batch\n"
+        "while the current batch is running, into a second set of ASIDs and pagetables.\n"
+        "Requires --concretize=random or planned, and halves the maximum --batch-size.\n"
+      ),
+      FLAG(
+        NULL, "--cpu-groups", ENABLE_CPU_GROUPS,
+        "run multiple instances of each test at once (default: off)\n"
+        "\n"
+        "partitions the CPUs into as many groups as there are enough CPUs for the test's threads,\n"
+        "each running its share of the runs on its own ASIDs and heap regions.\n"
+        "The results of all the groups are collected together at the end.\n"
+        "Only applies with --concretize=random or planned, and to tests without fixed-location variables.\n"
+      ),
+      FLAG(
+        NULL, "--profile", ENABLE_PROFILE,
+        "profile the harness (default: off)\n"
+        "\n"
+        "counts the cycles each CPU spends in each phase of the harness (setup, barriers, the test itself, etc)\n"
+        "and prints the total, mean and p50/p99 of each phase after the results of each test.\n"
+        "Uses the PMU cycle counter if there is one, otherwise the generic timer.\n"
+      ),
+      FLAG(
+        NULL, "--global-harness", ENABLE_GLOBAL_HARNESS,
+        "share the harness' translations between all pagetables (default: off)\n"
+        "\n"
+        "maps the parts of the address space that are the same in every pagetable\n"
+        "(code, data, heap, pagetables and the harness' view of memory) as global,\n"
+        "so changing ASID or invalidating a test's ASID does not evict them from the TLB.\n"
+      ),
+      OPT(
+        NULL, "--va-bits", va_bits,
+        "size of the virtual address space (default: 48)\n"
+        "\n"
+        "the harness and the tests only use the bottom 192G of VA space,\n"
+        "so with --va-bits=39 the pagetables can be walked from level 1,\n"
+        "one fewer level for the hardware to walk and for the harness to save and restore for each variable.\n"
+        "Tests then cannot use the level 0 entries of their variables.\n"
+        "Must be between 39 and 48, pagetables start at level 0 for more than 39 bits.\n",
+        .arg = OPT_ARG_REQUIRED,
+      ),
+      OPT(
+        NULL, "--pmu-events", pmu_events,
+        "count PMU events during each run\n"
+        "\n"
+        "accepts a comma-separated list of up to 6 PMUv3 events,\n"
+        "which are counted on each test thread around the test itself\n"
+        "and summed over the threads of each run.\n"
+        "The mean and variance of each event over the runs with each outcome\n"
+        "are printed after that outcome in the histogram.\n"
+        "\n"
+        "events can be given by name or as a hex event number:\n"
+        " l1d_refill, l1d_cache, l1d_tlb_refill, l2d_refill, l2d_cache, l2d_tlb_refill,\n"
+        " dtlb_walk, itlb_walk, ld_retired, st_retired, inst_retired, br_mis_pred,\n"
+        " exc_taken, exc_return, cpu_cycles, mem_access, bus_access,\n"
+        " stall_frontend, stall_backend, ...\n"
+        "Example:\n"
+        " ./litmus.exe --pmu-events=l1d_refill,l2d_refill,0x24 MP+pos\n"
+        "Requires FEAT_PMUv3.\n",
+        .arg = OPT_ARG_REQUIRED,
+      ),
       OPT(
         "-n", NULL, n,
         "number of runs per test\n"
@@ -560,8 +741,9 @@ argdef_t LITMUS_ARGS = (argdef_t){
         "number of runs per batch\n"
         "\n"
         "sets the number of runs per batch\n"
-        "X must be an integer (default: 1).\n"
-        "up to maximum number of ASIDs (e.g. 2^8).\n"
+        "X must be a positive integer (default: 1), or auto.\n"
+        "auto picks 256 when using --tlbsync=ASID with 16-bit ASIDs, and 1 otherwise.\n"
+        "up to maximum number of ASIDs (2^8 or 2^16, depending on the hardware).\n"
         "If not using --tlbsync=ASID then this must be 1"
       ),
       ENUMERATE(
@@ -603,34 +785,38 @@ argdef_t LITMUS_ARGS = (argdef_t){
         " in-between tests."
       ),
       ENUMERATE(
-        "--shuffle", LITMUS_SHUFFLE_TYPE, shuffle_type_t, 2, ARR((const char*[]){ "none", "rand" }),
-        ARR((shuffle_type_t[]){ SHUF_NONE, SHUF_RAND }),
+        "--shuffle", LITMUS_SHUFFLE_TYPE, shuffle_type_t, 3, ARR((const char*[]){ "none", "rand", "feistel" }),
+        ARR((shuffle_type_t[]){ SHUF_NONE, SHUF_RAND, SHUF_FEISTEL }),
         "type of shuffle control\n"
         "\n"
         "controls the order of access to allocated pages\n"
         "shuffling the indexes more should lead to more interesting caching results.\n"
         "\n"
         "none: access pages in-order\n"
-        "rand: access pages in random order"
+        "rand: access pages in random order\n"
+        "feistel: access pages in random order, computing the order on the fly rather than storing it\n"
+        "         (for very large -n)"
       ),
       ENUMERATE(
-        "--concretize", LITMUS_CONCRETIZATION_TYPE, concretize_type_t, 3,
-        ARR((const char*[]){ "linear", "random", "fixed" }),
-        ARR((concretize_type_t[]){ CONCRETE_LINEAR, CONCRETE_RANDOM, CONCRETE_FIXED }),
+        "--concretize", LITMUS_CONCRETIZATION_TYPE, concretize_type_t, 4,
+        ARR((const char*[]){ "linear", "random", "fixed", "planned" }),
+        ARR((concretize_type_t[]){ CONCRETE_LINEAR, CONCRETE_RANDOM, CONCRETE_FIXED, CONCRETE_PLANNED }),
         "test concretization algorithml\n"
         "\n"
         "controls the memory layout of generated concrete tests\n"
         "\n"
         "linear: allocate each var as a fixed shape and walk linearly over memory\n"
         "random: allocate randomly\n"
-        "fixed: always use the same address, random or can be manually picked via --config-concretize"
+        "fixed: always use the same address, random or can be manually picked via --config-concretize\n"
+        "planned: allocate randomly, but only ever pick from the addresses that satisfy the test's constraints\n"
+        "         (so never has to retry, see the concretization attempts with --verbose)"
       ),
       OPT(
         NULL, "--config-concretize", conc_cfg,
         "concretization-specific configuration\n"
         "\n"
         "the format differs depending on the value of --concretize:\n"
-        "for random, linear: do nothing.\n"
+        "for random, linear, planned: do nothing.\n"
         "for fixed:\n"
         "format:  [<var>=<value]*\n"
         "example: \n"
@@ -655,6 +841,10 @@ argdef_t UNITTEST_ARGS = (argdef_t){
         NULL, "--test-random-concretization", ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM,
         "include random concretization tests (default: on)\n"
       ),
+      FLAG(
+        NULL, "--test-planned-concretization", ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED,
+        "include planned concretization tests (default: on)\n"
+      ),
       NULL,
     },
 };
@@ -59,6 +59,20 @@ void debug_valloc_status(void) {
       free_chunks,
       free_mem
     );
+
+    for (u64 i = 0; i < NUM_SLAB_CLASSES; i++) {
+      valloc_slab_class* cls = &mem.slab_classes[i];
+      printf(
+        "(valloc)  slab %ld B: #slabs=%ld (max %ld, %ld empty) #live=%ld #allocs=%ld #frees=%ld\n",
+        SLAB_MIN_SIZE << i,
+        cls->no_slabs,
+        cls->max_slabs,
+        cls->empty != NULL ? 1UL : 0UL,
+        cls->no_live,
+        cls->no_allocs,
+        cls->no_frees
+      );
+    }
   }
 }
 
@@ -34,18 +34,247 @@
  *      i) set VA for V on run i to start + offset of V
  *    b) incremenet start up to the next available place
  *        (such that the next set of variables will not collide with previous ones)
+ *
+ * Steps 1 and 2 are done once, in concretize_linear_init,
+ * and give the layout of one run: the offset of each var and the total size (the stride).
+ *
+ * The stride is aligned to the largest owned or pinned region,
+ * so placing a whole layout at any multiple of the stride keeps all the relations.
+ * Each region of the test data is cut into slots of one stride,
+ * and the run with count r gets slot r % no_slots,
+ * so each run is just a base plus the offsets, however many constraints the test has.
+ *
+ * Runs in the same batch always get different slots,
+ * but later batches re-use the slots of earlier ones.
  */
 
 #include "lib.h"
 
+/* see litmus_test_random_concretization.c */
+extern u64 var_testdata_pa(var_info_t* vinfo, u64 va);
+
+typedef struct
+{
+  u64 stride;           /* size of one run's layout */
+  u64 slots_per_region; /* how many layouts fit in one region */
+  u64 no_slots;         /* how many layouts fit in all the ctx's regions */
+  u64 offsets[];        /* offset of each var from the start of the layout */
+} concretization_st_t;
+
+/** the smallest offset at or above pos that has the same last shift bits as otheroffs
+ */
+static u64 match_offset(u64 pos, u64 otheroffs, u64 shift) {
+  u64 matched = ALIGN_TO(pos, shift) | (otheroffs & BITMASK(shift));
+  if (matched < pos)
+    matched += 1UL << shift;
+  return matched;
+}
+
+/* own_level_t and pin_level_t share the names of region sizes,
+ * but a var is never smaller than 64 bits */
+static u64 level_shift(u64 lvl) {
+  return lvl == REGION_VAR ? 3 : MAX(LEVEL_SHIFTS[lvl], 3);
+}
+
+/** place the vars pinned to var, each after the last, at the offsets they relate to
+ *
+ * returns the end of the last pinned var placed
+ */
+static u64 place_pins(
+  test_ctx_t* ctx, concretization_st_t* st, u8* placed, var_info_t** pins, var_info_t* var, u64* max_shift
+) {
+  u64 pos = st->offsets[var->varidx];
+  u64 cur = pos;
+  u64 end = pos;
+
+  for (pin_level_t lvl = REGION_SAME_VAR; lvl < REGION_SAME_PGD; lvl++) {
+    var_idx_t no_pins = count_pinned_to(pins, ctx, var, lvl);
+
+    for (var_idx_t p = 0; p < no_pins; p++) {
+      var_info_t* pinvar = pins[p];
+      u64 pinpos;
+
+      if (lvl == REGION_SAME_VAR) {
+        pinpos = pos;
+      } else {
+        u64 gran = 1UL << level_shift(lvl - 1);
+        pinpos = ALIGN_POW2(cur, gran) + gran;
+      }
+
+      if (pinvar->init_attrs.has_region_offset) {
+        var_idx_t othervaridx = pinvar->init_attrs.region_offset.offset_var;
+        fail_on(
+          !placed[othervaridx],
+          "! concretize_linear: cannot place \"%s\" before the var it is offset from, \"%s\"\n",
+          pinvar->name,
+          ctx->heap_vars[othervaridx].name
+        );
+        pinpos = match_offset(
+          pinpos, st->offsets[othervaridx], LEVEL_SHIFTS[pinvar->init_attrs.region_offset.offset_level]
+        );
+      }
+
+      u64 shift = level_shift(lvl);
+      if (ALIGN_TO(pinpos, shift) != ALIGN_TO(pos, shift)) {
+        fail(
+          "! concretize_linear: cannot fit \"%s\" in the same %s as \"%s\"\n",
+          pinvar->name,
+          pin_level_to_str(lvl),
+          var->name
+        );
+      }
+
+      st->offsets[pinvar->varidx] = pinpos;
+      placed[pinvar->varidx] = 1;
+      cur = MAX(cur, pinpos);
+      end = MAX(end, pinpos + sizeof(u64));
+      *max_shift = MAX(*max_shift, shift);
+    }
+  }
+
+  return end;
+}
+
+/** the unplaced var that owns the largest region
+ * and does not relate to any var without an offset yet,
+ * or NULL if there are none
+ */
+static var_info_t* next_owner(test_ctx_t* ctx, u8* placed) {
+  var_info_t* best = NULL;
+  var_info_t* var;
+
+  FOREACH_HEAP_VAR(ctx, var) {
+    if (placed[var->varidx] || !var_owns_region(var))
+      continue;
+
+    if (var->init_attrs.has_region_offset && !placed[var->init_attrs.region_offset.offset_var])
+      continue;
+
+    if (best == NULL || var_owned_region_size(var) > var_owned_region_size(best))
+      best = var;
+  }
+
+  return best;
+}
+
+/** steps 1 and 2 above:
+ * compute the offset of each var, and the stride of the whole layout
+ *
+ * returns the first var that neither owns a region nor is pinned to one that was placed,
+ * or NULL if all were placed
+ */
+static var_info_t* plan_layout(test_ctx_t* ctx, const litmus_test_t* cfg, concretization_st_t* st) {
+  u8* placed = ALLOC_MANY(u8, cfg->no_heap_vars);
+  var_info_t** pins = ALLOC_MANY(var_info_t*, cfg->no_heap_vars);
+  u64 max_shift = PAGE_SHIFT;
+  u64 cur = 0;
+
+  for (var_idx_t v = 0; v < cfg->no_heap_vars; v++) {
+    placed[v] = 0;
+  }
+
+  var_info_t* var;
+  while ((var = next_owner(ctx, placed)) != NULL) {
+    u64 shift = level_shift(var_owned_region_size(var));
+    u64 pos = ALIGN_UP(cur, shift);
+
+    if (var->init_attrs.has_region_offset) {
+      var_idx_t othervaridx = var->init_attrs.region_offset.offset_var;
+      pos = match_offset(pos, st->offsets[othervaridx], LEVEL_SHIFTS[var->init_attrs.region_offset.offset_level]);
+    }
+
+    st->offsets[var->varidx] = pos;
+    placed[var->varidx] = 1;
+    max_shift = MAX(max_shift, shift);
+
+    u64 end = ALIGN_TO(pos, shift) + (1UL << shift);
+    cur = MAX(end, place_pins(ctx, st, placed, pins, var, &max_shift));
+  }
+
+  var_info_t* unplaced = NULL;
+  FOREACH_HEAP_VAR(ctx, var) {
+    if (!placed[var->varidx]) {
+      unplaced = var;
+      break;
+    }
+
+    DEBUG(DEBUG_CONCRETIZATION, "offset[%s] = %p\n", var->name, st->offsets[var->varidx]);
+  }
+
+  st->stride = ALIGN_UP(cur, max_shift);
+
+  FREE(pins);
+  FREE(placed);
+  return unplaced;
+}
+
+var_info_t* concretize_linear_unplaced_var(test_ctx_t* ctx, const litmus_test_t* cfg) {
+  concretization_st_t* st = ALLOC_SIZED(sizeof(concretization_st_t) + sizeof(u64) * cfg->no_heap_vars);
+  var_info_t* unplaced = plan_layout(ctx, cfg, st);
+  FREE(st);
+  return unplaced;
+}
+
 void* concretize_linear_init(test_ctx_t* ctx, const litmus_test_t* cfg, int no_runs) {
-  return NULL;
+  concretization_st_t* st = ALLOC_SIZED(sizeof(concretization_st_t) + sizeof(u64) * cfg->no_heap_vars);
+
+  var_info_t* unplaced = plan_layout(ctx, cfg, st);
+  fail_on(
+    unplaced != NULL,
+    "! concretize_linear: failed to place \"%s\", it must own a region or be pinned to one\n",
+    unplaced->name
+  );
+
+  if (st->stride > REGION_SIZE) {
+    fail(
+      "! concretize_linear: test %s needs %p bytes per run, more than fits in one region (%p)\n",
+      cfg->name,
+      st->stride,
+      REGION_SIZE
+    );
+  }
+
+  st->slots_per_region = REGION_SIZE / st->stride;
+  st->no_slots = st->slots_per_region * (ctx->heap_region_hi - ctx->heap_region_lo);
+
+  if (st->no_slots < ctx->batch_size) {
+    fail(
+      "! concretize_linear: only room for %ld runs of test %s at once, but the batch size is %ld\n",
+      st->no_slots,
+      cfg->name,
+      ctx->batch_size
+    );
+  }
+
+  debug("linear concretization of %s: stride=%p, %ld slots\n", cfg->name, st->stride, st->no_slots);
+  return (void*)st;
 }
 
 void concretize_linear_finalize(test_ctx_t* ctx, const litmus_test_t* cfg, void* st) {
-  /* nop */
+  FREE(st);
+}
+
+void concretize_linear_one(test_ctx_t* ctx, const litmus_test_t* cfg, void* _st, run_idx_t run) {
+  concretization_st_t* st = _st;
+  u64 slot = run_count_from_idx(ctx, run) % st->no_slots;
+  u64 reg_ix = ctx->heap_region_lo + slot / st->slots_per_region;
+  u64 start = (slot % st->slots_per_region) * st->stride;
+
+  var_info_t* var;
+  FOREACH_HEAP_VAR(ctx, var) {
+    region_idx_t idx = (region_idx_t){ .reg_ix = reg_ix, .reg_offs = start + st->offsets[var->varidx] };
+    u64 va = va_from_region_idx(ctx, var, idx);
+
+    /* if pgtable is off, pick the right phys addr */
+    if (!ENABLE_PGTABLE && var_owns_phys_region(var))
+      va = var_testdata_pa(var, va);
+
+    var->values[run] = (u64*)va;
+  }
 }
 
 void concretize_linear_all(test_ctx_t* ctx, const litmus_test_t* cfg, void* st, int no_runs) {
-  /* nop */
+  for (run_idx_t i = 0; i < no_runs; i++) {
+    concretize_linear_one(ctx, cfg, st, i);
+  }
 }
@@ -0,0 +1,373 @@
+/** an ephemeral compatible concretization algorithm
+ * that picks at random like the random concretization,
+ * but never has to throw away a pick and try again.
+ *
+ * the random concretization picks a region for every var independently,
+ * then the offsets, then discards the whole pick if any owned regions overlap.
+ * with many owned or pinned vars at PMD or PUD level, most picks get discarded.
+ *
+ * instead, at init we plan:
+ *  1. an order for the vars, such that each var comes after the var it is pinned to
+ *     and the var it is offset from, with the vars that own the largest regions first
+ *  2. for each var, how far apart its possible positions are:
+ *     the size of the region it owns, or the size of the offset it relates by,
+ *     whichever is larger.
+ *
+ * then for each run, for each var in that order,
+ * the positions that satisfy its constraints form an arithmetic sequence
+ * (over all the regions for owners, or inside the pinned region for pins)
+ * from which we remove the ranges that would overlap an already-picked var,
+ * and pick one of what's left uniformly at random.
+ */
+
+#include "lib.h"
+
+/* see litmus_test_random_concretization.c */
+extern u64 var_testdata_pa(var_info_t* vinfo, u64 va);
+
+typedef struct
+{
+  u64 lo;
+  u64 hi;
+} range_t;
+
+typedef struct
+{
+  var_info_t** order; /* the order to pick the vars in */
+
+  /* the picks of the current run */
+  u64* reg_ix;
+  u64* reg_offs;
+  u8* picked;
+
+  /* scratch space for the ranges of positions that are not free */
+  range_t* taken;
+} concretization_st_t;
+
+/* own_level_t, pin_level_t and rel_offset_t share the names of region sizes,
+ * but a var is never smaller than 64 bits, and never larger than a region */
+static u64 level_shift(u64 lvl) {
+  if (lvl == REGION_VAR)
+    return 3;
+
+  return MIN(MAX(LEVEL_SHIFTS[lvl], 3), REGION_SHIFT);
+}
+
+static u64 offset_shift(var_info_t* var) {
+  if (!var->init_attrs.has_region_offset)
+    return 3;
+
+  return level_shift(var->init_attrs.region_offset.offset_level);
+}
+
+/** the start and end (within its region) of what a picked var takes up
+ */
+static range_t var_range(concretization_st_t* st, var_info_t* var) {
+  u64 offs = st->reg_offs[var->varidx];
+
+  if (var_owns_region(var)) {
+    u64 shift = level_shift(var_owned_region_size(var));
+    return (range_t){ .lo = ALIGN_TO(offs, shift), .hi = ALIGN_TO(offs, shift) + (1UL << shift) };
+  }
+
+  return (range_t){ .lo = offs, .hi = offs + sizeof(u64) };
+}
+
+static bool is_ready(test_ctx_t* ctx, u8* planned, var_info_t* var) {
+  if (var->init_attrs.has_region_offset && !planned[var->init_attrs.region_offset.offset_var])
+    return false;
+
+  if (var->ty == VAR_PINNED && !planned[var->pin.pin_region_var])
+    return false;
+
+  return true;
+}
+
+/** step 1: order the vars
+ *
+ * pins as soon as they can be, so they are placed before other owners fill their pinned region
+ * then the owners of the largest regions
+ */
+static void plan_order(test_ctx_t* ctx, const litmus_test_t* cfg, concretization_st_t* st) {
+  u8* planned = ALLOC_MANY(u8, cfg->no_heap_vars);
+  for (var_idx_t v = 0; v < cfg->no_heap_vars; v++) {
+    planned[v] = 0;
+  }
+
+  for (var_idx_t i = 0; i < cfg->no_heap_vars; i++) {
+    var_info_t* best = NULL;
+    var_info_t* var;
+
+    FOREACH_HEAP_VAR(ctx, var) {
+      if (planned[var->varidx] || !is_ready(ctx, planned, var))
+        continue;
+
+      if (best == NULL) {
+        best = var;
+      } else if (var_owns_region(best)) {
+        if (!var_owns_region(var) || var_owned_region_size(var) > var_owned_region_size(best))
+          best = var;
+      }
+    }
+
+    fail_on(
+      best == NULL,
+      "! concretize_planned: test %s has a cycle of pinned or offset variables\n",
+      cfg->name
+    );
+
+    st->order[i] = best;
+    planned[best->varidx] = 1;
+    DEBUG(DEBUG_CONCRETIZATION, "order[%ld] = %s\n", i, best->name);
+  }
+
+  FREE(planned);
+}
+
+void* concretize_planned_init(test_ctx_t* ctx, const litmus_test_t* cfg) {
+  concretization_st_t* st = ALLOC_ONE(concretization_st_t);
+  st->order = ALLOC_MANY(var_info_t*, cfg->no_heap_vars);
+  st->reg_ix = ALLOC_MANY(u64, cfg->no_heap_vars);
+  st->reg_offs = ALLOC_MANY(u64, cfg->no_heap_vars);
+  st->picked = ALLOC_MANY(u8, cfg->no_heap_vars);
+  st->taken = ALLOC_MANY(range_t, cfg->no_heap_vars);
+
+  plan_order(ctx, cfg, st);
+  return (void*)st;
+}
+
+void concretize_planned_finalize(test_ctx_t* ctx, const litmus_test_t* cfg, void* _st) {
+  concretization_st_t* st = _st;
+  FREE(st->taken);
+  FREE(st->picked);
+  FREE(st->reg_offs);
+  FREE(st->reg_ix);
+  FREE(st->order);
+  FREE(st);
+}
+
+/** pick uniformly from the positions base + g*gran in each of the regions [reg_lo, reg_lo+no_regs),
+ * for g in [0, no_per_reg), of something of the given size,
+ * that do not overlap anything already picked
+ * (the new var may go in the region owned by pinned_to, just not at the same place)
+ *
+ * returns false if there are no such positions
+ */
+static bool pick_free(
+  test_ctx_t* ctx, concretization_st_t* st, var_info_t* pinned_to, u64 reg_lo, u64 no_regs, u64 base, u64 gran,
+  u64 no_per_reg, u64 size, region_idx_t* out
+) {
+  u64 no_taken = 0;
+  var_info_t* var;
+
+  /* for each picked var, the range of g whose [base + g*gran, +size) overlap it */
+  FOREACH_HEAP_VAR(ctx, var) {
+    if (!st->picked[var->varidx])
+      continue;
+
+    u64 reg = st->reg_ix[var->varidx];
+    if (reg < reg_lo || reg >= reg_lo + no_regs)
+      continue;
+
+    range_t r = var_range(st, var);
+    if (var == pinned_to)
+      r = (range_t){ .lo = st->reg_offs[var->varidx], .hi = st->reg_offs[var->varidx] + sizeof(u64) };
+
+    u64 g_lo = (r.lo + 1 <= size + base) ? 0 : (r.lo - size - base + gran) / gran;
+    u64 g_hi = (r.hi <= base) ? 0 : (r.hi - base + gran - 1) / gran;
+    g_hi = MIN(g_hi, no_per_reg);
+
+    if (g_lo >= g_hi)
+      continue;
+
+    /* insert it in order */
+    u64 off = (reg - reg_lo) * no_per_reg;
+    range_t taken = (range_t){ .lo = off + g_lo, .hi = off + g_hi };
+    u64 i = no_taken++;
+    while (i > 0 && st->taken[i - 1].lo > taken.lo) {
+      st->taken[i] = st->taken[i - 1];
+      i--;
+    }
+    st->taken[i] = taken;
+  }
+
+  /* count how many are free, merging overlapping ranges as we go */
+  u64 no_free = no_regs * no_per_reg;
+  u64 seen = 0;
+  for (u64 i = 0; i < no_taken; i++) {
+    u64 lo = MAX(st->taken[i].lo, seen);
+    if (lo < st->taken[i].hi) {
+      no_free -= st->taken[i].hi - lo;
+      seen = st->taken[i].hi;
+    }
+  }
+
+  if (no_free == 0)
+    return false;
+
+  /* the j'th free position, skipping over the taken ones */
+  u64 j = randrange(0, no_free);
+  seen = 0;
+  for (u64 i = 0; i < no_taken; i++) {
+    u64 lo = MAX(st->taken[i].lo, seen);
+    if (lo >= st->taken[i].hi)
+      continue;
+
+    if (j < lo)
+      break;
+
+    j += st->taken[i].hi - lo;
+    seen = st->taken[i].hi;
+  }
+
+  *out = (region_idx_t){ .reg_ix = reg_lo + j / no_per_reg, .reg_offs = base + (j % no_per_reg) * gran };
+  return true;
+}
+
+/** pick a region and offset for a var that owns a region
+ *
+ * anywhere in the ctx's regions that is not already taken,
+ * with the same last bits as the var it is offset from
+ */
+static void pick_owner(test_ctx_t* ctx, concretization_st_t* st, var_info_t* var) {
+  u64 own_shift = level_shift(var_owned_region_size(var));
+  u64 offs_shift = offset_shift(var);
+  u64 gran_shift = MAX(own_shift, offs_shift);
+
+  /* the bits of the offset below gran_shift are the same for every position */
+  u64 fixed = 0;
+  if (var->init_attrs.has_region_offset)
+    fixed = st->reg_offs[var->init_attrs.region_offset.offset_var] & BITMASK(offs_shift);
+
+  /* ... any left between the offset and the owned region are free to pick */
+  if (offs_shift < own_shift)
+    fixed |= randrange(0, 1UL << (own_shift - offs_shift)) << offs_shift;
+
+  /* the concretizer never picks the last region */
+  u64 reg_lo = ctx->heap_region_lo;
+  u64 no_regs = MAX(ctx->heap_region_hi - 1 - reg_lo, 1);
+
+  region_idx_t idx;
+  bool ok = pick_free(
+    ctx,
+    st,
+    NULL,
+    reg_lo,
+    no_regs,
+    ALIGN_TO(fixed, own_shift),
+    1UL << gran_shift,
+    REGION_SIZE >> gran_shift,
+    1UL << own_shift,
+    &idx
+  );
+  fail_on(!ok, "! concretize_planned: no room left for \"%s\"\n", var->name);
+
+  idx.reg_offs |= fixed & BITMASK(own_shift);
+  st->reg_ix[var->varidx] = idx.reg_ix;
+  st->reg_offs[var->varidx] = idx.reg_offs;
+}
+
+/** pick an offset for a var pinned to another
+ *
+ * anywhere in the pinned region of the var it's pinned to that is not already taken,
+ * with the same last bits as the var it is offset from
+ */
+static void pick_pin(test_ctx_t* ctx, concretization_st_t* st, var_info_t* var) {
+  var_info_t* rootvar = &ctx->heap_vars[var->pin.pin_region_var];
+  u64 reg = st->reg_ix[rootvar->varidx];
+  u64 rootoffs = st->reg_offs[rootvar->varidx];
+
+  st->reg_ix[var->varidx] = reg;
+
+  /* allowed to be at the same VA */
+  if (var->pin.pin_region_level == REGION_SAME_VAR) {
+    st->reg_offs[var->varidx] = rootoffs;
+    return;
+  }
+
+  u64 pin_shift = level_shift(var->pin.pin_region_level);
+  u64 offs_shift = offset_shift(var);
+  u64 window = ALIGN_TO(rootoffs, pin_shift);
+
+  u64 fixed = 0;
+  if (var->init_attrs.has_region_offset)
+    fixed = st->reg_offs[var->init_attrs.region_offset.offset_var] & BITMASK(offs_shift);
+
+  region_idx_t idx;
+  bool ok;
+
+  if (offs_shift >= pin_shift) {
+    /* the offset decides the whole position,
+     * so there is just the one to check against the other picks */
+    fail_on(
+      (fixed & ~BITMASK(pin_shift)) != (rootoffs & BITMASK(offs_shift) & ~BITMASK(pin_shift)),
+      "! concretize_planned: \"%s\" cannot be both pinned to \"%s\" and at the offset it relates to\n",
+      var->name,
+      rootvar->name
+    );
+    ok = pick_free(
+      ctx, st, rootvar, reg, 1, window | (fixed & BITMASK(pin_shift)), 1UL << pin_shift, 1, sizeof(u64), &idx
+    );
+    fail_on(
+      !ok,
+      "! concretize_planned: \"%s\" at the offset it relates to overlaps another var in \"%s\"'s region\n",
+      var->name,
+      rootvar->name
+    );
+    st->reg_offs[var->varidx] = idx.reg_offs;
+    return;
+  }
+
+  ok = pick_free(
+    ctx,
+    st,
+    rootvar,
+    reg,
+    1,
+    window | fixed,
+    1UL << offs_shift,
+    1UL << (pin_shift - offs_shift),
+    sizeof(u64),
+    &idx
+  );
+  fail_on(!ok, "! concretize_planned: no room left for \"%s\" next to \"%s\"\n", var->name, rootvar->name);
+  st->reg_offs[var->varidx] = idx.reg_offs;
+}
+
+void concretize_planned_one(test_ctx_t* ctx, const litmus_test_t* cfg, void* _st, run_idx_t run) {
+  concretization_st_t* st = _st;
+
+  for (var_idx_t v = 0; v < cfg->no_heap_vars; v++) {
+    st->picked[v] = 0;
+  }
+
+  for (var_idx_t i = 0; i < cfg->no_heap_vars; i++) {
+    var_info_t* var = st->order[i];
+
+    if (var->ty == VAR_PINNED)
+      pick_pin(ctx, st, var);
+    else
+      pick_owner(ctx, st, var);
+
+    st->picked[var->varidx] = 1;
+  }
+
+  var_info_t* var;
+  FOREACH_HEAP_VAR(ctx, var) {
+    region_idx_t idx = (region_idx_t){ .reg_ix = st->reg_ix[var->varidx], .reg_offs = st->reg_offs[var->varidx] };
+    u64 va = va_from_region_idx(ctx, var, idx);
+
+    /* if pgtable is off, pick the right phys addr */
+    if (!ENABLE_PGTABLE && var_owns_phys_region(var))
+      va = var_testdata_pa(var, va);
+
+    var->values[run] = (u64*)va;
+    DEBUG(DEBUG_CONCRETIZATION, "%s.va = %p\n", var->name, var->values[run]);
+  }
+}
+
+void concretize_planned_all(test_ctx_t* ctx, const litmus_test_t* cfg, void* st, run_idx_t no_runs) {
+  for (run_idx_t i = 0; i < ctx->no_runs; i++) {
+    concretize_planned_one(ctx, cfg, st, i);
+  }
+}
@@ -154,10 +154,33 @@ static void pick_pin_region(
   );
 }
 
+/** move a var that owns a whole page or 2M dir
+ * down to the nearest page or dir that nothing in the batch uses yet
+ *
+ * this saves concretize_batch_avoiding from rejecting the whole run
+ * when the random pick lands on memory an earlier run took.
+ */
+static region_idx_t move_to_free_space(test_ctx_t* ctx, region_idx_t idx, own_level_t lvl) {
+  u64 offs;
+
+  if (ctx->batch_trackers == NULL)
+    return idx;
+
+  if (lvl == REGION_OWN_PAGE) {
+    if (tracker_find_free_page(ctx->batch_trackers, idx.reg_ix, idx.reg_offs, &offs))
+      idx.reg_offs = offs | (idx.reg_offs & BITMASK(PAGE_SHIFT));
+  } else if (lvl == REGION_OWN_PMD) {
+    if (tracker_find_free_dir(ctx->batch_trackers, idx.reg_ix, idx.reg_offs, &offs))
+      idx.reg_offs = offs | (idx.reg_offs & BITMASK(PMD_SHIFT));
+  }
+
+  return idx;
+}
+
 static void pick_one_region(test_ctx_t* ctx, concretization_st_t* st, var_info_t* var, own_level_t lvl) {
-  region_idx_t va_begin = region_idx_bottom();
-  region_idx_t va_top = region_idx_top();
-  region_idx_t va_idx = rand_idx(va_begin, va_top);
+  region_idx_t va_begin = region_idx_bottom(ctx);
+  region_idx_t va_top = region_idx_top(ctx);
+  region_idx_t va_idx = move_to_free_space(ctx, rand_idx(va_begin, va_top), lvl);
 
   DEBUG(
     DEBUG_CONCRETIZATION,
@@ -284,6 +307,9 @@ void concretize_random_one(test_ctx_t* ctx, const litmus_test_t* cfg, concretiza
     }
   }
 
+  /* concretize_one counts the first */
+  ctx->concretize_attempts += count - 1;
+
   FOREACH_HEAP_VAR(ctx, var) {
     /* if pgtable is off, pick the right phys addr */
     if (!ENABLE_PGTABLE) {
@@ -1,53 +1,153 @@
 #include "lib.h"
 
-/** calculate the offset this region is at in the regions_t
- */
-static u64 __region_offset(regions_t* regions, region_trackers_t* trackers, u64* va) {
-  return BIT_SLICE((u64)va, 38, 30) - BIT_SLICE((u64)regions, 38, 30);
+/* one bit per cache line,
+ * lines smaller than 1/64th of a page share a bit,
+ * so that the lines of a page always fit in one word */
+#define LINE_SHIFT MAX(CACHE_LINE_SHIFT, PAGE_SHIFT - 6)
+
+region_trackers_t* alloc_region_trackers(void) {
+  return ALLOC_ONE(region_trackers_t);
 }
 
-/** calculate the offset this dir is into the region
+void free_region_trackers(region_trackers_t* trackers) {
+  for (u64 r = 0; r < NR_REGIONS; r++) {
+    for (u64 d = 0; d < NR_DIRS_PER_REGION; d++) {
+      if (trackers->regions[r].lines[d] != NULL)
+        FREE(trackers->regions[r].lines[d]);
+    }
+  }
+
+  FREE(trackers);
+}
+
+/** split a PA into the indices of its region, dir, page and line
+ *
+ * returns false if it is not in the test data
  */
-static u64 __dir_offset(regions_t* regions, region_trackers_t* trackers, u64* va) {
-  /* since the region isn't aligned on a 1G boundary
-   * but is aligned on a 2M boundary
-   * we work out the offset from the start of the regions.
-   */
-  return BIT_SLICE((u64)va, 29, 21) - BIT_SLICE((u64)regions, 29, 21);
+static bool tracker_idx(u64 pa, u64* reg, u64* dir, u64* page, u64* line) {
+  if (pa < BOT_OF_TESTDATA)
+    return false;
+
+  u64 offs = pa - BOT_OF_TESTDATA;
+  *reg = offs >> REGION_SHIFT;
+  if (*reg >= NR_REGIONS)
+    return false;
+
+  *dir = BIT_SLICE(offs, REGION_SHIFT - 1, PMD_SHIFT);
+  *page = BIT_SLICE(offs, PMD_SHIFT - 1, PAGE_SHIFT);
+  *line = BIT_SLICE(offs, PAGE_SHIFT - 1, LINE_SHIFT);
+  return true;
 }
 
-static u64 __page_offset(regions_t* regions, region_trackers_t* trackers, u64* va) {
-  return BIT_SLICE((u64)va, 20, 12);
+void tracker_mark(region_trackers_t* trackers, u64 pa) {
+  u64 reg, dir, page, line;
+  if (!tracker_idx(pa, &reg, &dir, &page, &line))
+    return;
+
+  region_tracker_t* t = &trackers->regions[reg];
+  if (t->lines[dir] == NULL)
+    t->lines[dir] = ALLOC_MANY(u64, NR_PAGES_PER_DIR);
+
+  t->lines[dir][page] |= 1UL << line;
+  t->pages[dir][page / 64] |= 1UL << (page % 64);
+  t->dirs |= 1UL << dir;
 }
 
-static u64 __cache_line_offset(regions_t* regions, region_trackers_t* trackers, u64* va) {
-  /* the cache-line-of-minimum-size is not fixed in the architecture
-   * but it must be a power of 2
-   */
-  return BIT_SLICE((u64)va, 11, CACHE_LINE_SHIFT);
+bool tracker_is_taken(region_trackers_t* trackers, u64 pa) {
+  u64 reg, dir, page, line;
+  if (!tracker_idx(pa, &reg, &dir, &page, &line))
+    return false;
+
+  region_tracker_t* t = &trackers->regions[reg];
+
+  /* most of the test data is free, so most lookups stop at the summaries */
+  if (!(t->dirs & (1UL << dir)))
+    return false;
+
+  if (!(t->pages[dir][page / 64] & (1UL << (page % 64))))
+    return false;
+
+  return (t->lines[dir][page] & (1UL << line)) != 0;
 }
 
-// static u64 __value_offset(regions_t* regions, region_trackers_t* trackers, u64* va) {
-//   u64 offset =
-//     (u64)va & BITMASK(CACHE_LINE_SHIFT);
-//   return offset;
-// }
+/** the highest clear bit of words[0..nwords) at or below bit ix,
+ * or if there are none, the highest clear bit above ix.
+ *
+ * returns false if all the bits are set
+ */
+static bool highest_clear_bit(u64* words, u64 nwords, u64 ix, u64* out) {
+  u64 start = ix / 64;
+  u64 below = ~0UL >> (63 - ix % 64); /* bits 0..ix of the start word */
+
+  /* first search down from ix ... */
+  u64 w = start;
+  u64 clear = ~words[w] & below;
+  while (clear == 0 && w > 0) {
+    w--;
+    clear = ~words[w];
+  }
+
+  /* ... then wrap around to the top */
+  if (clear == 0) {
+    for (w = nwords - 1; w > start; w--) {
+      clear = ~words[w];
+      if (clear)
+        break;
+    }
+
+    if (clear == 0)
+      clear = ~words[start] & ~below;
+  }
 
-region_tracker_t* tracker_region(regions_t* regions, region_trackers_t* trackers, u64* va) {
-  return &trackers->regions[__region_offset(regions, trackers, va)];
+  if (clear == 0)
+    return false;
+
+  *out = w * 64 + 63 - __builtin_clzl(clear);
+  return true;
 }
 
-dir_tracker_t* tracker_dir(regions_t* regions, region_trackers_t* trackers, u64* va) {
-  region_tracker_t* reg = tracker_region(regions, trackers, va);
-  return &reg->dir_ixs[__dir_offset(regions, trackers, va)];
+bool tracker_find_free_page(region_trackers_t* trackers, u64 reg, u64 offs, u64* out) {
+  region_tracker_t* t = &trackers->regions[reg];
+  u64 page;
+
+  /* the pages summaries of all the dirs in the region are one array of words */
+  if (!highest_clear_bit(&t->pages[0][0], NR_DIRS_PER_REGION * NR_PAGES_PER_DIR / 64, offs >> PAGE_SHIFT, &page))
+    return false;
+
+  *out = page << PAGE_SHIFT;
+  return true;
 }
 
-page_tracker_t* tracker_page(regions_t* regions, region_trackers_t* trackers, u64* va) {
-  dir_tracker_t* dir = tracker_dir(regions, trackers, va);
-  return &dir->page_ixs[__page_offset(regions, trackers, va)];
+bool tracker_find_free_dir(region_trackers_t* trackers, u64 reg, u64 offs, u64* out) {
+  region_tracker_t* t = &trackers->regions[reg];
+
+  /* the dirs past the end of the region are never free */
+  u64 dirs = t->dirs | ~BITMASK(NR_DIRS_PER_REGION);
+  u64 dir;
+
+  if (!highest_clear_bit(&dirs, 1, offs >> PMD_SHIFT, &dir))
+    return false;
+
+  *out = dir << PMD_SHIFT;
+  return true;
 }
 
-cache_line_tracker_t* tracker_cache_line(regions_t* regions, region_trackers_t* trackers, u64* va) {
-  page_tracker_t* pg = tracker_page(regions, trackers, va);
-  return &pg->scl_ix[__cache_line_offset(regions, trackers, va)];
-}
\ No newline at end of file
+void tracker_clear(region_trackers_t* trackers) {
+  for (u64 r = 0; r < NR_REGIONS; r++) {
+    region_tracker_t* t = &trackers->regions[r];
+
+    /* only visit the dirs, and pages in them, that have something marked */
+    while (t->dirs) {
+      u64 dir = __builtin_ctzl(t->dirs);
+      t->dirs &= t->dirs - 1;
+
+      for (u64 w = 0; w < NR_PAGES_PER_DIR / 64; w++) {
+        while (t->pages[dir][w]) {
+          u64 page = w * 64 + __builtin_ctzl(t->pages[dir][w]);
+          t->pages[dir][w] &= t->pages[dir][w] - 1;
+          t->lines[dir][page] = 0;
+        }
+      }
+    }
+  }
+}
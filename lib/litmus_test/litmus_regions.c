@@ -4,13 +4,13 @@ void initialize_regions(regions_t* r) {
   /* the test data (variables etc) are placed into
    * physical address space TOP_OF_HEAP -> TOP_OF_MEM
    *
-   * we allocate 16 x 8M contiguous regions
-   * but spread evenly throughout the 128G VA space
+   * we allocate up to NR_REGIONS x 8M contiguous regions
+   * but spread evenly throughout the 64G VA space
    *
    * see vmm_pgtable.c
    */
 
-  for (int i = 0; i < NR_REGIONS; i++) {
+  for (int i = 0; i < NO_TESTDATA_REGIONS; i++) {
     u64 start_va;
 
     if (ENABLE_PGTABLE)
@@ -47,12 +47,14 @@ u64 va_from_region_idx(test_ctx_t* ctx, var_info_t* var, region_idx_t idx) {
   return va;
 }
 
-region_idx_t region_idx_bottom() {
-  return (region_idx_t){ .reg_ix = 0, .reg_offs = 0 };
+/* the first and last regions available to the ctx,
+ * with --cpu-groups each group only gets a share of them */
+region_idx_t region_idx_bottom(test_ctx_t* ctx) {
+  return (region_idx_t){ .reg_ix = ctx->heap_region_lo, .reg_offs = 0 };
 }
 
-region_idx_t region_idx_top() {
-  return (region_idx_t){ .reg_ix = NR_REGIONS - 1, .reg_offs = BITMASK(REGION_SHIFT) };
+region_idx_t region_idx_top(test_ctx_t* ctx) {
+  return (region_idx_t){ .reg_ix = ctx->heap_region_hi - 1, .reg_offs = BITMASK(REGION_SHIFT) };
 }
 
 inline char* region_idx_to_str(region_idx_t ix) {
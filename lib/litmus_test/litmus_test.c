@@ -7,29 +7,37 @@
 static lock_t __harness_lock;
 
 static void go_cpus(int cpu, void* a);
+static void run_test_in_groups(const litmus_test_t* cfg, u64 no_groups);
 static void run_thread(test_ctx_t* ctx, int cpu);
 static void end_of_test(test_ctx_t* ctx);
 static void start_of_test(test_ctx_t* ctx);
 static void end_of_thread(test_ctx_t* ctx, int cpu);
 static void start_of_thread(test_ctx_t* ctx, int cpu);
-static void end_of_run(test_ctx_t* ctx, int cpu, int vcpu, run_idx_t i, run_count_t r);
+static void end_of_batch(test_ctx_t* ctx, int cpu, run_count_t batch_start_idx, run_count_t batch_end_idx);
 static void start_of_run(test_ctx_t* ctx, int cpu, int vcpu, run_idx_t i, run_count_t r);
 
 /* entry point */
 void run_test(const litmus_test_t* cfg) {
+  /* use same seed for each test
+   * this means we can re-run just 1 test from whole batch
+   * and still get determinism (up to relaxation) */
+  reset_seed();
+
+  u64 no_groups = cfg_no_cpu_groups(cfg, NO_CPUS);
+  if (no_groups > 1) {
+    run_test_in_groups(cfg, no_groups);
+    return;
+  }
+
   /* create test context obj
    * make sure it's on the heap
    * if we're passing to another thread
    */
   test_ctx_t* ctx = ALLOC_ONE(test_ctx_t);
 
-  /* use same seed for each test
-   * this means we can re-run just 1 test from whole batch
-   * and still get determinism (up to relaxation) */
-  reset_seed();
-
   /* create the dynamic configuration (context) from the static information (cfg) */
   init_test_ctx(ctx, cfg, NUMBER_OF_RUNS, RUNS_IN_BATCH);
+
   ctx->valloc_ptable_chkpnt = valloc_ptable_checkpoint();
   initialize_regions(&ctx->heap_memory);
 
@@ -44,16 +52,94 @@ void run_test(const litmus_test_t* cfg) {
     }
     printf("\n");
   }
-  run_on_cpus((async_fn_t*)go_cpus, (void*)ctx);
+  test_ctx_t* ctxs[1] = { ctx };
+  run_on_cpus((async_fn_t*)go_cpus, (void*)ctxs);
 
   /* clean up and display results */
   end_of_test(ctx);
+  valloc_ptable_restore(ctx->valloc_ptable_chkpnt);
+  free_test_ctx(ctx);
+  FREE(ctx);
+}
+
+/** run the test as independent instances, one per group of CPUs
+ *
+ * each instance gets its share of the runs, CPUs, ASIDs and heap regions,
+ * and its own barriers and histogram.  at the end all the histograms
+ * are merged into the first, and the results printed as one test.
+ */
+static void run_test_in_groups(const litmus_test_t* cfg, u64 no_groups) {
+  test_ctx_t** ctxs = ALLOC_MANY(test_ctx_t*, no_groups);
+
+  valloc_ptable_mem chkpnt = valloc_ptable_checkpoint();
+
+  for (u64 g = 0; g < no_groups; g++) {
+    u64 no_runs = NUMBER_OF_RUNS / no_groups;
+    if (g == 0)
+      no_runs += NUMBER_OF_RUNS % no_groups;
+
+    ctxs[g] = ALLOC_ONE(test_ctx_t);
+    init_test_ctx(ctxs[g], cfg, no_runs, MIN(RUNS_IN_BATCH, no_runs));
+    set_ctx_cpu_group(ctxs[g], g, no_groups);
+    ctxs[g]->valloc_ptable_chkpnt = chkpnt;
+    initialize_regions(&ctxs[g]->heap_memory);
+    start_of_test(ctxs[g]);
+  }
+
+  verbose("  (in %ld groups of %ld CPUs)\n", no_groups, ctxs[0]->no_cpus);
+  run_on_cpus((async_fn_t*)go_cpus, (void*)ctxs);
+
+  /* collect all the results into the first group's, and print them as a whole */
+  for (u64 g = 1; g < no_groups; g++) {
+    merge_results(ctxs[0], ctxs[0]->hist, ctxs[g]->hist);
+    ctxs[0]->no_runs += ctxs[g]->no_runs;
+
+    ctxs[0]->asid_rollovers += ctxs[g]->asid_rollovers;
+    ctxs[0]->concretize_runs += ctxs[g]->concretize_runs;
+    ctxs[0]->concretize_attempts += ctxs[g]->concretize_attempts;
+    ctxs[0]->concretize_max_attempts = MAX(ctxs[0]->concretize_max_attempts, ctxs[g]->concretize_max_attempts);
+
+    if (ctxs[0]->profile != NULL)
+      merge_profile(ctxs[0]->profile, ctxs[g]->profile);
+  }
+
+  end_of_test(ctxs[0]);
+
+  for (u64 g = 1; g < no_groups; g++) {
+    concretize_finalize(LITMUS_CONCRETIZATION_TYPE, ctxs[g], cfg, ctxs[g]->no_runs, ctxs[g]->concretization_st);
+  }
+
+  valloc_ptable_restore(chkpnt);
+
+  for (u64 g = 0; g < no_groups; g++) {
+    free_test_ctx(ctxs[g]);
+    FREE(ctxs[g]);
+  }
+
+  FREE(ctxs);
 }
 
+/** each physical CPU runs the ctx of the group it is in
+ * with its index within that group
+ */
 static void go_cpus(int cpu, void* a) {
-  test_ctx_t* ctx = (test_ctx_t*)a;
+  test_ctx_t** ctxs = (test_ctx_t**)a;
+  test_ctx_t* ctx = NULL;
+
+  for (u64 g = 0; g < ctxs[0]->no_groups; g++) {
+    if (ctxs[g]->cpu_base <= cpu && cpu < ctxs[g]->cpu_base + ctxs[g]->no_cpus) {
+      ctx = ctxs[g];
+      break;
+    }
+  }
+
+  /* CPUs left over after partitioning sit this test out */
+  if (ctx == NULL)
+    return;
+
+  cpu -= ctx->cpu_base;
   start_of_thread(ctx, cpu);
-  run_thread(ctx, cpu);
+  PROFILE(ctx, cpu, PROF_THREAD, run_thread(ctx, cpu));
   end_of_thread(ctx, cpu);
 }
 
@@ -80,6 +166,8 @@ run_idx_t count_to_run_index(test_ctx_t* ctx, run_count_t i) {
     return (run_idx_t)i;
   case SHUF_RAND:
     return ctx->shuffled_ixs[i];
+  case SHUF_FEISTEL:
+    return (run_idx_t)permute(&ctx->shuffle_perm, i);
   default:
     fail("! unknown LITMUS_SHUFFLE_TYPE: %d/%s\n", LITMUS_SHUFFLE_TYPE, shuff_type_to_str(LITMUS_SHUFFLE_TYPE));
     return 0;
@@ -91,48 +179,120 @@ run_idx_t count_to_run_index(test_ctx_t* ctx, run_count_t i) {
  */
 static void allocate_affinities(test_ctx_t* ctx) {
   if (LITMUS_AFF_TYPE != AFF_NONE) {
-    shuffle((int*)ctx->affinity, sizeof(int), NO_CPUS);
-    debug("set affinity = %Ad\n", ctx->affinity, NO_CPUS);
+    shuffle((int*)ctx->affinity, sizeof(int), ctx->no_cpus);
+    debug("set affinity = %Ad\n", ctx->affinity, ctx->no_cpus);
   }
 }
 
-/** run concretization and initialization for the runs of this batch
+/** whether the pipelined runner has a spare CPU,
+ * one not running a test thread, to prepare the next batch on
  */
-static void allocate_data_for_batch(test_ctx_t* ctx, u64 vcpu, run_count_t batch_start_idx, run_count_t batch_end_idx) {
-  debug("vCPU%d allocating test data for batch starting %ld\n", vcpu, batch_start_idx);
+static bool pipeline_has_spare_cpu(test_ctx_t* ctx) {
+  return LITMUS_RUNNER_TYPE == RUNNER_PIPELINED && ctx->cfg->no_threads < ctx->no_cpus;
+}
 
-  if (vcpu == 0) {
-    /* first we have to allocate new pagetables for the whole batch
-    * cleaning up any previous ones as we do
-    */
-    if (ENABLE_PGTABLE) {
-      for (run_count_t r = batch_start_idx; r < batch_end_idx; r++) {
-        u64 asid = asid_from_run_count(ctx, r);
+/** pick the VAs for the runs of a batch
+ *
+ * the memory of the runs from avoid_start_idx up to the batch may still be in use
+ * so the new batch must not overlap it.
+ *
+ * the runs are picked one after the other, each avoiding the ones before it,
+ * so this always runs on a single CPU.
+ */
+static void concretize_runs_of_batch(
+  test_ctx_t* ctx, run_count_t avoid_start_idx, run_count_t batch_start_idx, run_count_t batch_end_idx
+) {
+  if (LITMUS_RUNNER_TYPE == RUNNER_EPHEMERAL || LITMUS_RUNNER_TYPE == RUNNER_PIPELINED) {
+    concretize_batch_avoiding(
+      LITMUS_CONCRETIZATION_TYPE, ctx, ctx->cfg, avoid_start_idx, batch_start_idx, batch_end_idx
+    );
+  }
+}
 
-        if (ctx->ptables[asid] == NULL) {
-          ctx->ptables[asid] = vmm_alloc_new_test_pgtable();
-        }
+/** allocate the pagetables and write the initial state
+ * of every step'th run of a concretized batch, starting from the first'th
+ *
+ * each run has its own pagetable and (once concretized) its own memory
+ * so different CPUs can initialise different runs of the same batch at once.
+ */
+static void init_batch(test_ctx_t* ctx, run_count_t batch_start_idx, run_count_t batch_end_idx, u64 first, u64 step) {
+  for (run_count_t r = batch_start_idx + first; r < batch_end_idx; r += step) {
+    /* first we have to allocate a new pagetable for the run */
+    if (ENABLE_PGTABLE) {
+      u64 asid = asid_from_run_count(ctx, r);
+      u64** ptable = &ctx->ptables[ptable_idx_from_run_count(ctx, r)];
 
-        debug("allocated pgtable for batch_start=%ld, ASID=%ld at %p\n", batch_start_idx, asid, ctx->ptables[asid]);
+      if (*ptable == NULL) {
+        *ptable = vmm_alloc_new_test_pgtable();
       }
+
+      debug("allocated pgtable for batch_start=%ld, ASID=%ld at %p\n", batch_start_idx, asid, *ptable);
     }
 
+    /* then initialise the memory and pagetable */
     if (LITMUS_RUNNER_TYPE != RUNNER_ARRAY) {
-      if (LITMUS_RUNNER_TYPE == RUNNER_EPHEMERAL) {
-        concretize_batch(LITMUS_CONCRETIZATION_TYPE, ctx, ctx->cfg, batch_start_idx, batch_end_idx);
-      }
-
-      /* initialise the memory and pagetables */
-      for (run_count_t r = batch_start_idx; r < batch_end_idx; r++) {
-        run_idx_t i = count_to_run_index(ctx, r);
-        if (LITMUS_RUNNER_TYPE == RUNNER_SEMI_ARRAY || LITMUS_RUNNER_TYPE == RUNNER_EPHEMERAL) {
-          write_init_state(ctx, ctx->cfg, i);
-        }
-      }
+      run_idx_t i = count_to_run_index(ctx, r);
+      write_init_state(ctx, ctx->cfg, i);
     }
   }
 }
 
+/** run concretization and initialization for the runs of a batch on one CPU
+ */
+static void prepare_batch(
+  test_ctx_t* ctx, run_count_t avoid_start_idx, run_count_t batch_start_idx, run_count_t batch_end_idx
+) {
+  concretize_runs_of_batch(ctx, avoid_start_idx, batch_start_idx, batch_end_idx);
+  init_batch(ctx, batch_start_idx, batch_end_idx, 0, 1);
+}
+
+/** run concretization and initialization for the runs of this batch
+ *
+ * vCPU0 concretizes the whole batch,
+ * then all the CPUs share out the pagetable allocation and initial writes,
+ * each taking every no_cpus'th run.
+ *
+ * all CPUs must call this.
+ */
+static void allocate_data_for_batch(
+  test_ctx_t* ctx, u64 cpu, u64 vcpu, run_count_t batch_start_idx, run_count_t batch_end_idx
+) {
+  debug("vCPU%d allocating test data for batch starting %ld\n", vcpu, batch_start_idx);
+
+  if (vcpu == 0) {
+    concretize_runs_of_batch(ctx, batch_start_idx, batch_start_idx, batch_end_idx);
+  }
+
+  /* wait for the VAs of every run to be picked before anyone writes them */
+  BWAIT(cpu, ctx->generic_cpu_barrier, ctx->no_cpus);
+
+  init_batch(ctx, batch_start_idx, batch_end_idx, cpu, ctx->no_cpus);
+}
+
+/** with the pipelined runner,
+ * run concretization and initialization for the batch after this one
+ * while this one runs on the test threads.
+ *
+ * the next batch uses the other set of ASIDs and pagetables (see asid_from_run_count)
+ * and its memory must not overlap this batch's.
+ */
+static void allocate_data_for_next_batch(
+  test_ctx_t* ctx, u64 vcpu, run_count_t batch_start_idx, run_count_t batch_end_idx
+) {
+  run_count_t next_start_idx = batch_end_idx;
+  run_count_t next_end_idx = MIN(next_start_idx + ctx->batch_size, ctx->no_runs);
+
+  if (next_start_idx >= ctx->no_runs)
+    return;
+
+  debug("vCPU%d allocating test data for next batch starting %ld\n", vcpu, next_start_idx);
+
+  /* only the first spare vCPU prepares */
+  if (vcpu == ctx->cfg->no_threads) {
+    prepare_batch(ctx, batch_start_idx, next_start_idx, next_end_idx);
+  }
+}
+
 static u64 run_data_size(test_ctx_t* ctx) {
   u64 actual_size = (
     /* the VAs of the variables themselves */
@@ -190,7 +350,8 @@ static void setup_run_data(
       run->va[v] = p;
 
       if (ENABLE_PGTABLE) {
-        for (int lvl = 0; lvl < 4; lvl++) {
+        /* the levels above where the hardware starts its walk are left NULL */
+        for (int lvl = VMM_START_LEVEL; lvl < 4; lvl++) {
           run->tt_entries[v][lvl] = vmm_pte_at_level(ptable_from_run(ctx, i), (u64)p, lvl);
           run->tt_descs[v][lvl] = *run->tt_entries[v][lvl];
         }
@@ -212,6 +373,8 @@ static void clean_run_data(
   int idx;
   run_count_t r;
 
+  vmm_pte_batch_t batch;
+
   /* after each run, reset the pagetables back to what they were before
    * we ran the test function
    *
@@ -220,35 +383,57 @@ static void clean_run_data(
    * NOTE: this does not mean reset pagetables back to the initial state
    * -- the refreshed tables will still contain level3 entries for the
    * allocated pages.
+   *
+   * the next run to use these pagetables will do so with a fresh ASID
+   * (see asid_from_run_count) so there is no need to invalidate this run's ASID,
+   * and as nothing can be using them until then there is no need for break-before-make either.
+   * so only the entries the test actually changed are written back,
+   * with one DSB at the end for all of them.
    */
   if (ENABLE_PGTABLE) {
+    u64 restored = 0;
+    vmm_begin_pte_batch(&batch, SYNC_NONE, 0);
+
     for (idx = 0, r = batch_start_idx; r < batch_end_idx; r++, idx++) {
-      u64 asid = asid_from_run_count(ctx, r);
       for (var_idx_t v = 0; v < ctx->cfg->no_heap_vars; v++) {
-        for (int l = 0; l < 4; l++) {
-          vmm_update_pte(runs[idx].tt_entries[v][l], runs[idx].tt_descs[v][l], SYNC_ASID, asid, /* force */ true);
+        for (int l = VMM_START_LEVEL; l < 4; l++) {
+          u64* entry = runs[idx].tt_entries[v][l];
+          u64 desc = runs[idx].tt_descs[v][l];
+
+          if (*entry != desc) {
+            vmm_batch_update_pte(&batch, entry, desc, 0);
+            restored++;
+          }
         }
       }
     }
+
+    vmm_commit_pte_batch(&batch);
+
+    debug("vCPU%d restored %ld pagetable entries for batch starting %ld\n", vcpu, restored, batch_start_idx);
   }
 
   FREE(arena);
 }
 
-/** invalidate all the ASIDs being used for the next batch
+/** ensure there are no TLB entries for the ASIDs of the next batch
+ *
+ * within an ASID generation each batch has ASIDs that have not been used since the last flush,
+ * so this only has to flush the TLB at the start of each generation.
+ *
+ * the TLBI is broadcast, so only one CPU has to do it,
+ * and the other threads wait for it at the start barrier of the first run.
+ *
+ * with --cpu-groups this also flushes the other groups' entries,
+ * which costs them some TLB misses but does not affect their correctness.
  */
-static void clean_tlb_for_batch(test_ctx_t* ctx, run_count_t batch_start_idx, run_count_t batch_end_idx) {
-  dsb();
-
-  if (cpu_needs_workaround(ERRATA_WORKAROUND_ISB_AFTER_PTE_ST))
-    isb();
+static void clean_tlb_for_batch(test_ctx_t* ctx, u64 vcpu, run_count_t batch_start_idx, run_count_t batch_end_idx) {
+  if (!ENABLE_PGTABLE || vcpu != 0 || !asid_generation_starts_at(ctx, batch_start_idx))
+    return;
 
-  for (run_count_t r = batch_start_idx; r < batch_end_idx; r++) {
-    u64 asid = asid_from_run_count(ctx, r);
-    tlbi_asid(asid);
-  }
-
-  dsb();
+  debug("new ASID generation from batch starting %ld\n", batch_start_idx);
+  vmm_flush_tlb();
+  ctx->asid_rollovers++;
 }
 
 typedef struct
@@ -292,7 +477,7 @@ static void restore_old_sync_exception_handlers(test_ctx_t* ctx, u64 vcpu, excep
 static void prepare_test_contexts(
   test_ctx_t* ctx, u64 vcpu, run_count_t batch_start_idx, run_count_t batch_end_idx, exception_handlers_refs_t* handlers
 ) {
-  clean_tlb_for_batch(ctx, batch_start_idx, batch_end_idx);
+  clean_tlb_for_batch(ctx, vcpu, batch_start_idx, batch_end_idx);
 }
 
 /** switch to a particular run's ASID
@@ -337,7 +522,7 @@ static void return_to_harness_context(test_ctx_t* ctx, u64 cpu, u64 vcpu, except
   }
 
   if (ENABLE_PGTABLE && LITMUS_SYNC_TYPE == SYNC_ASID) {
-    vmm_switch_ttable_asid(vmm_pgtables[cpu], 0);
+    vmm_switch_ttable_asid(vmm_pgtables[ctx->cpu_base + cpu], 0);
   }
 }
 
@@ -361,6 +546,18 @@ static u64 get_affinity(test_ctx_t* ctx, u64 cpu) {
   return 0;
 }
 
+/** save how much each PMU event counter went up by since start, for this thread of the run
+ */
+static void record_pmu_events(test_ctx_t* ctx, u64 vcpu, run_idx_t i, u64* start) {
+  u64 now[PMU_MAX_EVENTS];
+  pmu_read_events(now, NO_PMU_EVENTS);
+
+  for (u64 e = 0; e < NO_PMU_EVENTS; e++) {
+    /* the event counters are only 32 bits wide without FEAT_PMUv3p5 */
+    ctx->pmu_counts[e][i * ctx->cfg->no_threads + vcpu] = (now[e] - start[e]) & 0xffffffffUL;
+  }
+}
+
 /** run the tests in a loop
  */
 static void run_thread(test_ctx_t* ctx, int cpu) {
@@ -371,15 +568,18 @@ static void run_thread(test_ctx_t* ctx, int cpu) {
    * to do this we have to ensure that each test that gets run is given a separate ASID
    * and each test has its own pagetable to manipulate (so they do not interfere with other tests).
    *
-   * at the start of a batch we allocate $N pagetables for each test, using ASIDS 0..$N
-   * if we have available ASIDs 0..255 (aka 8-bit ASIDs) then we reserve ASID 0 for the test harness itself
-   * and allocate ASIDs 1...127 for the tests (aka 127 runs)
-   * and reserve ASIDs 128..255 as spare ASIDs for tests.
+   * at the start of a batch we allocate $N pagetables for each test, and give each the next unused ASID
+   * ASID 0 is reserved for the test harness itself, and the rest (1..MAX_ASID, which is 65535
+   * with 16-bit ASIDs, or 255 where the hardware only has 8-bit ones) are handed out to successive batches.
+   * a run of batches that fits in those ASIDs is one generation, and the TLB is only flushed
+   * at the start of each generation, not for every batch (see asid_from_run_count and clean_tlb_for_batch).
    *
    * Hence the max batch size is entirely determined by the number of bits available for ASIDs that we have.
    *
-   * then at the end of the batch, we clean all the ASIDS, free all the pagetables, flush any caches that may need flushing.
+   * then at the end of the batch, we reset the pagetables, and flush any caches that may need flushing.
    */
+  u64 pmu_start[PMU_MAX_EVENTS];
+
   for (run_count_t j = 0; j < ctx->no_runs;) {
     u64 vcpu; /* the test thread this physical core will execute */
 
@@ -393,26 +593,39 @@ static void run_thread(test_ctx_t* ctx, int cpu) {
       ensure_new_affinity(ctx, cpu);
 
     /* wait for affinities to be assigned before continuing */
-    BWAIT(cpu, ctx->generic_cpu_barrier, NO_CPUS);
+    PROFILE(ctx, cpu, PROF_BWAIT_BATCH, BWAIT(cpu, ctx->generic_cpu_barrier, ctx->no_cpus));
 
     vcpu = get_affinity(ctx, cpu);
     set_vcpu(vcpu);
 
-    allocate_data_for_batch(ctx, vcpu, batch_start_idx, batch_end_idx);
-    /* since only 1 vCPU will allocate pagetables to ensure consistency
-     * we wait for them to have finished before continuing and trying to read
+    /* the pipelined runner already prepared this batch during the previous one */
+    if (!pipeline_has_spare_cpu(ctx) || batch_start_idx == 0)
+      PROFILE(ctx, cpu, PROF_ALLOCATE_BATCH, allocate_data_for_batch(ctx, cpu, vcpu, batch_start_idx, batch_end_idx));
+
+    /* since each CPU initialises only some of the runs
+     * we wait for them all to have finished before continuing and trying to read
      * the PTEs
      */
-    BWAIT(cpu, ctx->generic_cpu_barrier, NO_CPUS);
+    PROFILE(ctx, cpu, PROF_BWAIT_BATCH, BWAIT(cpu, ctx->generic_cpu_barrier, ctx->no_cpus));
 
     litmus_test_run runs[ctx->batch_size];
     valloc_arena* arena = ALLOC_SIZED(sizeof(valloc_arena) + run_data_size(ctx) * ctx->batch_size);
     arena_init(arena, run_data_size(ctx) * ctx->batch_size);
-    setup_run_data(ctx, vcpu, batch_start_idx, batch_end_idx, arena, runs);
+    PROFILE(ctx, cpu, PROF_SETUP_RUN_DATA, setup_run_data(ctx, vcpu, batch_start_idx, batch_end_idx, arena, runs));
 
     exception_handlers_refs_t handlers = { NULL, NULL, NULL };
 
-    prepare_test_contexts(ctx, vcpu, batch_start_idx, batch_end_idx, &handlers);
+    PROFILE(
+      ctx, cpu, PROF_PREPARE_CONTEXTS, prepare_test_contexts(ctx, vcpu, batch_start_idx, batch_end_idx, &handlers)
+    );
+
+    /* with the pipelined runner the spare CPUs do not take part in the runs at all
+     * and instead get on with the next batch */
+    if (pipeline_has_spare_cpu(ctx) && vcpu >= ctx->cfg->no_threads) {
+      PROFILE(ctx, cpu, PROF_ALLOCATE_BATCH, allocate_data_for_next_batch(ctx, vcpu, batch_start_idx, batch_end_idx));
+      j = batch_end_idx;
+    }
+
     for (int bi = 0; j < batch_end_idx; bi++, j++) {
       run_idx_t i = count_to_run_index(ctx, j);
       th_f* pre = ctx->cfg->setup_fns == NULL ? NULL : ctx->cfg->setup_fns[vcpu];
@@ -424,33 +637,46 @@ static void run_thread(test_ctx_t* ctx, int cpu) {
       }
 
       start_of_run(ctx, cpu, vcpu, i, j);
-      switch_to_test_context(ctx, vcpu, j, &handlers);
 
-      if (pre != NULL)
-        pre(&runs[bi]);
-
-      /* this barrier must be last thing before running function */
-      BWAIT(vcpu, &ctx->start_barriers[bi], ctx->cfg->no_threads);
-      func(&runs[bi]);
-
-      if (post != NULL) {
-        /* TODO: why restore/set vbar here?
-         */
-        restore_old_sync_exception_handlers(ctx, vcpu, &handlers);
-        post(&runs[bi]);
-        set_new_sync_exception_handlers(ctx, vcpu, &handlers);
-      }
+      PROFILE(ctx, cpu, PROF_SWITCH_TO_TEST, {
+        switch_to_test_context(ctx, vcpu, j, &handlers);
+
+        if (pre != NULL)
+          pre(&runs[bi]);
+      });
+
+      /* this barrier must be last thing before running function
+       * (other than snapshotting the PMU event counters) */
+      PROFILE(ctx, cpu, PROF_BWAIT_START, BWAIT(vcpu, &ctx->start_barriers[bi], ctx->cfg->no_threads));
+      if (ctx->pmu_counts != NULL)
+        pmu_read_events(pmu_start, NO_PMU_EVENTS);
+      PROFILE(ctx, cpu, PROF_TEST, func(&runs[bi]));
+      if (ctx->pmu_counts != NULL)
+        record_pmu_events(ctx, vcpu, i, pmu_start);
+
+      PROFILE(ctx, cpu, PROF_RETURN_TO_HARNESS, {
+        if (post != NULL) {
+          /* TODO: why restore/set vbar here?
+           */
+          restore_old_sync_exception_handlers(ctx, vcpu, &handlers);
+          post(&runs[bi]);
+          set_new_sync_exception_handlers(ctx, vcpu, &handlers);
+        }
 
-      return_to_harness_context(ctx, cpu, vcpu, &handlers);
+        return_to_harness_context(ctx, cpu, vcpu, &handlers);
+      });
 
       /* wait for all threads to finish and return to the harness' context
-       * before attempting to collect results */
-      BWAIT(vcpu, ctx->generic_vcpu_barrier, ctx->cfg->no_threads);
-      end_of_run(ctx, cpu, vcpu, i, j);
+       * before starting the next run */
+      PROFILE(ctx, cpu, PROF_BWAIT_RUN, BWAIT(vcpu, ctx->generic_vcpu_barrier, ctx->cfg->no_threads));
 run_thread_after_execution:
-      BWAIT(cpu, ctx->generic_cpu_barrier, NO_CPUS);
+      /* with the pipelined runner, the spare CPUs are busy with the next batch
+       * so only the test threads synchronise in-between runs */
+      if (!pipeline_has_spare_cpu(ctx))
+        PROFILE(ctx, cpu, PROF_BWAIT_RUN, BWAIT(cpu, ctx->generic_cpu_barrier, ctx->no_cpus));
     }
-    clean_run_data(ctx, vcpu, batch_start_idx, batch_end_idx, arena, runs);
+    PROFILE(ctx, cpu, PROF_END_OF_BATCH, end_of_batch(ctx, cpu, batch_start_idx, batch_end_idx));
+    PROFILE(ctx, cpu, PROF_CLEAN_RUN_DATA, clean_run_data(ctx, vcpu, batch_start_idx, batch_end_idx, arena, runs));
   }
 }
 
@@ -528,21 +754,18 @@ static void start_of_run(test_ctx_t* ctx, int cpu, int vcpu, run_idx_t i, run_co
   prefetch(ctx, i, r);
 }
 
-static void end_of_run(test_ctx_t* ctx, int cpu, int vcpu, run_idx_t i, run_count_t r) {
-  /* only 1 thread should collect the results, else they will be duplicated */
-  if (vcpu == 0) {
-    u64 time = read_clk();
-    if (time - ctx->last_tick > 10 * TICKS_PER_SEC || ctx->last_tick == 0) {
-      char time_str[100];
-      sprint_time(NEW_BUFFER(&time_str[0], 100), time, SPRINT_TIME_HHMMSS);
-      verbose("  [%s] %d/%d\n", time_str, r, ctx->no_runs);
-      ctx->last_tick = time;
-    }
-
-    handle_new_result(ctx, i, r);
+static void report_progress(test_ctx_t* ctx, run_count_t batch_start_idx, run_count_t batch_end_idx) {
+  u64 time = read_clk();
+  if (time - ctx->last_tick > 10 * TICKS_PER_SEC || ctx->last_tick == 0) {
+    char time_str[100];
+    sprint_time(NEW_BUFFER(&time_str[0], 100), time, SPRINT_TIME_HHMMSS);
+    verbose("  [%s] %d/%d\n", time_str, batch_end_idx, ctx->no_runs);
+    ctx->last_tick = time;
+  }
 
-    /* progress indicator */
-    u64 step = (ctx->no_runs / 10);
+  /* progress indicator, every run when there are fewer than 10 */
+  u64 step = MAX(1, ctx->no_runs / 10);
+  for (run_count_t r = batch_start_idx; r < batch_end_idx; r++) {
     if (r % step == 0) {
       trace("[%d/%d]\n", r, ctx->no_runs);
     } else if (r == ctx->no_runs - 1) {
@@ -551,10 +774,51 @@ static void end_of_run(test_ctx_t* ctx, int cpu, int vcpu, run_idx_t i, run_coun
   }
 }
 
+/** collect the results of the batch
+ *
+ * rather than have one thread add each run to the histogram
+ * while the others wait for it in-between runs,
+ * every CPU collects the outcomes for an equal share of the batch into its own histogram
+ * and CPU0 merges them all at the end.
+ */
+static void end_of_batch(test_ctx_t* ctx, int cpu, run_count_t batch_start_idx, run_count_t batch_end_idx) {
+  /* the pipelined runner does not wait for all CPUs after each run,
+   * so make sure the whole batch is done before collecting it */
+  if (pipeline_has_spare_cpu(ctx))
+    BWAIT(cpu, ctx->generic_cpu_barrier, ctx->no_cpus);
+
+  if (ENABLE_RESULTS_HIST) {
+    run_count_t n = batch_end_idx - batch_start_idx;
+    run_count_t from = batch_start_idx + (n * cpu) / ctx->no_cpus;
+    run_count_t to = batch_start_idx + (n * (cpu + 1)) / ctx->no_cpus;
+    stage_results(ctx, ctx->staged_hists[cpu], from, to);
+  }
+
+  BWAIT(cpu, ctx->generic_cpu_barrier, ctx->no_cpus);
+
+  if (cpu == 0) {
+    report_progress(ctx, batch_start_idx, batch_end_idx);
+
+    if (ENABLE_RESULTS_HIST) {
+      for (int c = 0; c < ctx->no_cpus; c++) {
+        merge_results(ctx, ctx->hist, ctx->staged_hists[c]);
+      }
+    } else {
+      for (run_count_t r = batch_start_idx; r < batch_end_idx; r++) {
+        handle_new_result(ctx, count_to_run_index(ctx, r), r);
+      }
+    }
+  }
+}
+
 static void start_of_thread(test_ctx_t* ctx, int cpu) {
+  /* the event counters can only be programmed from EL1 */
+  if (ctx->pmu_counts != NULL)
+    pmu_program_events(PMU_EVENTS, NO_PMU_EVENTS);
+
   /* ensure initial state gets propagated to all cores before continuing ...
   */
-  BWAIT(cpu, ctx->generic_cpu_barrier, NO_CPUS);
+  BWAIT(cpu, ctx->generic_cpu_barrier, ctx->no_cpus);
 
   /* before can drop to EL0, ensure EL0 has a valid mapped stack space
    */
@@ -567,22 +831,30 @@ static void end_of_thread(test_ctx_t* ctx, int cpu) {
   debug("end of thread\n");
   if (ENABLE_PGTABLE) {
     /* restore global non-test pgtable */
-    vmm_switch_ttable(vmm_pgtables[cpu]);
+    vmm_switch_ttable(vmm_pgtables[ctx->cpu_base + cpu]);
   }
 
-  BWAIT(cpu, ctx->generic_cpu_barrier, NO_CPUS);
+  BWAIT(cpu, ctx->generic_cpu_barrier, ctx->no_cpus);
   trace("CPU%d: end of test\n", cpu);
 }
 
 static void start_of_test(test_ctx_t* ctx) {
+  ctx->tlbi_count_start = tlbi_count();
   ctx->concretization_st = concretize_init(LITMUS_CONCRETIZATION_TYPE, ctx, ctx->cfg, ctx->no_runs);
-  if (LITMUS_RUNNER_TYPE == RUNNER_ARRAY) {
+  if (LITMUS_RUNNER_TYPE == RUNNER_ARRAY || LITMUS_RUNNER_TYPE == RUNNER_SEMI_ARRAY) {
     concretize(LITMUS_CONCRETIZATION_TYPE, ctx, ctx->cfg, ctx->concretization_st, ctx->no_runs);
+  }
+
+  /* the semi-array runner writes the initial state as each batch is prepared */
+  if (LITMUS_RUNNER_TYPE == RUNNER_ARRAY) {
     write_init_states(ctx, ctx->cfg, ctx->no_runs);
   }
 
-  verbose("running test: %s\n", ctx->cfg->name);
-  trace("====== %s ======\n", ctx->cfg->name);
+  /* with --cpu-groups, each group is an instance of the same test */
+  if (ctx->group == 0) {
+    verbose("running test: %s\n", ctx->cfg->name);
+    trace("====== %s ======\n", ctx->cfg->name);
+  }
 }
 
 static void end_of_test(test_ctx_t* ctx) {
@@ -593,11 +865,24 @@ static void end_of_test(test_ctx_t* ctx) {
     print_results(ctx->hist, ctx);
   }
 
+  print_profile(ctx);
+
+  verbose(
+    "%s: %ld TLBIs, %ld ASID generations\n", ctx->cfg->name, tlbi_count() - ctx->tlbi_count_start, ctx->asid_rollovers
+  );
+
+  if (ctx->concretize_runs > 0) {
+    verbose(
+      "%s: %ld concretization attempts for %ld runs (%ld per 100 runs, at most %ld for one run)\n",
+      ctx->cfg->name,
+      ctx->concretize_attempts,
+      ctx->concretize_runs,
+      (ctx->concretize_attempts * 100) / ctx->concretize_runs,
+      ctx->concretize_max_attempts
+    );
+  }
+
   trace("Finished test %s\n", ctx->cfg->name);
 
   concretize_finalize(LITMUS_CONCRETIZATION_TYPE, ctx, ctx->cfg, ctx->no_runs, ctx->concretization_st);
-
-  valloc_ptable_restore(ctx->valloc_ptable_chkpnt);
-  free_test_ctx(ctx);
-  FREE(ctx);
 }
\ No newline at end of file
@@ -51,7 +51,12 @@ extern void concretize_random_all(test_ctx_t* ctx, const litmus_test_t* cfg, voi
 extern void concretize_fixed_one(test_ctx_t* ctx, const litmus_test_t* cfg, run_idx_t run);
 extern void concretize_fixed_all(test_ctx_t* ctx, const litmus_test_t* cfg, run_idx_t no_runs);
 
+/* planned */
+extern void concretize_planned_one(test_ctx_t* ctx, const litmus_test_t* cfg, void* st, run_idx_t run);
+extern void concretize_planned_all(test_ctx_t* ctx, const litmus_test_t* cfg, void* st, run_idx_t no_runs);
+
 /* linear */
+extern void concretize_linear_one(test_ctx_t* ctx, const litmus_test_t* cfg, void* st, run_idx_t run);
 extern void concretize_linear_all(test_ctx_t* ctx, const litmus_test_t* cfg, void* st, run_idx_t no_runs);
 
 /** given a var and an index perform the necessary initialization
@@ -59,8 +64,10 @@ extern void concretize_linear_all(test_ctx_t* ctx, const litmus_test_t* cfg, voi
  *
  * assumes all the vars have their VAs assigned and the default
  * initial pagetable entries for all tests have been created
+ *
+ * the new entry is only written when the batch is committed
  */
-void set_init_pte(test_ctx_t* ctx, var_idx_t varidx, run_idx_t run) {
+void set_init_pte(test_ctx_t* ctx, var_idx_t varidx, run_idx_t run, vmm_pte_batch_t* batch) {
   if (!ENABLE_PGTABLE)
     return;
 
@@ -68,7 +75,6 @@ void set_init_pte(test_ctx_t* ctx, var_idx_t varidx, run_idx_t run) {
   u64* va = vinfo->values[run];
   u64* ptable = ptable_from_run(ctx, run);
   u64* pte = vmm_pte(ptable, (u64)vinfo->values[run]);
-  u64 asid = asid_from_run_count(ctx, run_count_from_idx(ctx, run));
 
   DEBUG(
     DEBUG_CONCRETIZATION,
@@ -125,15 +131,7 @@ void set_init_pte(test_ctx_t* ctx, var_idx_t varidx, run_idx_t run) {
     desc.oa = PAGE(otherpa) << PAGE_SHIFT;
   }
 
-  vmm_update_pte(
-    pte,
-    write_desc(desc),
-    LITMUS_SYNC_TYPE,
-    (LITMUS_SYNC_TYPE == SYNC_ASID) ? asid :
-    (LITMUS_SYNC_TYPE == SYNC_VA)   ? (u64)va :
-                                      0,
-    false
-  );
+  vmm_batch_update_pte(batch, pte, write_desc(desc), (u64)va);
 
   /* TODO: this definitely cannot be here if using SYNC_ASID !
    */
@@ -169,14 +167,14 @@ void set_init_pte(test_ctx_t* ctx, var_idx_t varidx, run_idx_t run) {
  * this will, for each run, for each VA, set the PTE entry for that VA
  * and then write the initial value (if applicable).
  */
-void set_init_var(test_ctx_t* ctx, var_idx_t varidx, run_idx_t run) {
+void set_init_var(test_ctx_t* ctx, var_idx_t varidx, run_idx_t run, vmm_pte_batch_t* batch) {
   var_info_t* vinfo = &ctx->heap_vars[varidx];
 
   u64* va = vinfo->values[run];
   DEBUG(
     DEBUG_CONCRETIZATION, "set_init_var for run %ld for var '%s' with va = %p\n", run, vinfo->name, vinfo->values[run]
   );
-  set_init_pte(ctx, varidx, run);
+  set_init_pte(ctx, varidx, run, batch);
 
   if (is_backed_var(vinfo)) {
     if (ENABLE_PGTABLE) {
@@ -194,10 +192,21 @@ void set_init_var(test_ctx_t* ctx, var_idx_t varidx, run_idx_t run) {
 }
 
 void write_init_state(test_ctx_t* ctx, const litmus_test_t* cfg, run_idx_t run) {
+  /* all the run's pagetable entries are updated together
+   * with one round of synchronisation for them all.
+   *
+   * with pagetables, the run's ASID has not been used since the TLB was last flushed
+   * (see asid_from_run_count and clean_tlb_for_batch)
+   * so there is nothing in the TLB for the new entries to invalidate. */
+  vmm_pte_batch_t batch;
+  vmm_begin_pte_batch(&batch, ENABLE_PGTABLE ? SYNC_NONE : LITMUS_SYNC_TYPE, asid_from_run(ctx, run));
+
   for (int v = 0; v < cfg->no_heap_vars; v++) {
-    set_init_var(ctx, v, run);
+    set_init_var(ctx, v, run, &batch);
   }
 
+  vmm_commit_pte_batch(&batch);
+
   /* check that the concretization was successful before continuing */
   concretization_postcheck(ctx, cfg, ctx->heap_vars, run);
 }
@@ -213,9 +222,12 @@ void pick_concrete_addrs(test_ctx_t* ctx, const litmus_test_t* cfg, run_idx_t ru
 void concretize_one(concretize_type_t type, test_ctx_t* ctx, const litmus_test_t* cfg, void* st, run_idx_t run) {
   concretization_precheck(ctx, cfg, ctx->heap_vars);
 
+  /* the random concretization counts its own retries on top */
+  ctx->concretize_attempts++;
+
   switch (type) {
   case CONCRETE_LINEAR:
-    fail("! concretize: cannot concretize_one with concretization=linear\n");
+    concretize_linear_one(ctx, cfg, st, run);
     break;
   case CONCRETE_RANDOM:
     concretize_random_one(ctx, cfg, st, run);
@@ -223,6 +235,9 @@ void concretize_one(concretize_type_t type, test_ctx_t* ctx, const litmus_test_t
   case CONCRETE_FIXED:
     concretize_fixed_one(ctx, cfg, run);
     break;
+  case CONCRETE_PLANNED:
+    concretize_planned_one(ctx, cfg, st, run);
+    break;
   default:
     fail(
       "! concretize_one: got unexpected concretization type: %s (%s)\n",
@@ -248,6 +263,9 @@ void concretize(concretize_type_t type, test_ctx_t* ctx, const litmus_test_t* cf
   case CONCRETE_FIXED:
     concretize_fixed_all(ctx, cfg, no_runs);
     break;
+  case CONCRETE_PLANNED:
+    concretize_planned_all(ctx, cfg, st, no_runs);
+    break;
   default:
     fail(
       "! concretize: got unexpected concretization type: %s (%s)\n",
@@ -258,13 +276,42 @@ void concretize(concretize_type_t type, test_ctx_t* ctx, const litmus_test_t* cf
   }
 }
 
+/** mark the data used by a run in the trackers
+ */
+static void mark_run(test_ctx_t* ctx, region_trackers_t* trackers, run_idx_t run) {
+  var_info_t* var;
+  FOREACH_HEAP_VAR(ctx, var) {
+    tracker_mark(trackers, SAFE_TESTDATA_PA((u64)ctx_heap_var_va(ctx, var->varidx, run)));
+  }
+}
+
 void concretize_batch(
   concretize_type_t type, test_ctx_t* ctx, const litmus_test_t* cfg, run_count_t batch_start_idx,
   run_count_t batch_end_idx
 ) {
-  debug("concretizing batch=%ld..%ld...\n", batch_start_idx, batch_end_idx);
+  concretize_batch_avoiding(type, ctx, cfg, batch_start_idx, batch_start_idx, batch_end_idx);
+}
+
+void concretize_batch_avoiding(
+  concretize_type_t type, test_ctx_t* ctx, const litmus_test_t* cfg, run_count_t avoid_start_idx,
+  run_count_t batch_start_idx, run_count_t batch_end_idx
+) {
+  debug("concretizing batch=%ld..%ld (avoiding from %ld)...\n", batch_start_idx, batch_end_idx, avoid_start_idx);
+
+  if (ctx->batch_trackers == NULL)
+    ctx->batch_trackers = alloc_region_trackers();
+
+  /* the trackers hold the cache lines used by every run from avoid_start_idx
+   * up to the one being concretized */
+  region_trackers_t* trackers = ctx->batch_trackers;
+  tracker_clear(trackers);
+  for (run_count_t r0 = avoid_start_idx; r0 < batch_start_idx; r0++) {
+    mark_run(ctx, trackers, count_to_run_index(ctx, r0));
+  }
+
   for (run_count_t r = batch_start_idx; r < batch_end_idx; r++) {
     run_idx_t i = count_to_run_index(ctx, r);
+    u64 attempts_start = ctx->concretize_attempts;
 repeat_loop:
     debug("attempting concretizing batch run#%ld\n", r);
     concretize_one(type, ctx, ctx->cfg, ctx->concretization_st, i);
@@ -273,38 +320,28 @@ repeat_loop:
     /* we can assume that for a single concretizate_one it doesn't overlap
       * but we cannot assume that different calls don't overlap
       *
-      * so we check whether the one we just allocated overlaps with previous ones
+      * so we check whether the one we just allocated shares a cache line with previous ones
       * and if it does, we try again.
       */
-    for (run_count_t r0 = batch_start_idx; r0 < r; r0++) {
-      debug("concretizing batch=%ld..%ld\n", batch_start_idx, batch_end_idx);
-      run_idx_t i0 = count_to_run_index(ctx, r0);
-      var_info_t* v1;
-      var_info_t* v2;
-      FOREACH_HEAP_VAR(ctx, v1) {
-        /* foreach VA we just allocated */
-        u64 va1 = (u64)ctx_heap_var_va(ctx, v1->varidx, i);
-        u64 pa1 = SAFE_TESTDATA_PA(va1);
-
-        FOREACH_HEAP_VAR(ctx, v2) {
-          /* foreach VA we allocated in previous run r0 */
-          u64 va2 = (u64)ctx_heap_var_va(ctx, v2->varidx, i0);
-          u64 pa2 = SAFE_TESTDATA_PA(va2);
-
-          /* if they overlap, try allocate the last VAs again */
-          if (pa1 == pa2) {
-            debug("got overlap on #%ld, trying again...\n", r);
-            goto repeat_loop;
-          }
-        }
+    var_info_t* var;
+    FOREACH_HEAP_VAR(ctx, var) {
+      u64 pa = SAFE_TESTDATA_PA((u64)ctx_heap_var_va(ctx, var->varidx, i));
+      if (tracker_is_taken(trackers, pa)) {
+        debug("got overlap on #%ld, trying again...\n", r);
+        goto repeat_loop;
       }
     }
 
+    mark_run(ctx, trackers, i);
+
+    ctx->concretize_runs++;
+    ctx->concretize_max_attempts = MAX(ctx->concretize_max_attempts, ctx->concretize_attempts - attempts_start);
     debug("concretized batch=%ld..%ld\n", batch_start_idx, batch_end_idx);
   }
 }
 
 void* concretize_random_init(test_ctx_t* ctx, const litmus_test_t* cfg);
+void* concretize_planned_init(test_ctx_t* ctx, const litmus_test_t* cfg);
 void concretized_fixed_init(test_ctx_t* ctx, const litmus_test_t* cfg);
 void* concretize_linear_init(test_ctx_t* ctx, const litmus_test_t* cfg, run_idx_t no_runs);
 
@@ -320,6 +357,8 @@ void* concretize_init(concretize_type_t type, test_ctx_t* ctx, const litmus_test
   case CONCRETE_FIXED:
     concretized_fixed_init(ctx, cfg);
     break;
+  case CONCRETE_PLANNED:
+    return concretize_planned_init(ctx, cfg);
   default:
     fail(
       "! concretize_allocate_st: got unexpected concretization type: %s (%s)\n",
@@ -334,6 +373,7 @@ void* concretize_init(concretize_type_t type, test_ctx_t* ctx, const litmus_test
 
 void concretize_linear_finalize(test_ctx_t* ctx, const litmus_test_t* cfg, void* st);
 void concretize_random_finalize(test_ctx_t* ctx, const litmus_test_t* cfg, void* st);
+void concretize_planned_finalize(test_ctx_t* ctx, const litmus_test_t* cfg, void* st);
 
 /** cleanup after a run
  *
@@ -351,6 +391,9 @@ void concretize_finalize(
     break;
   case CONCRETE_FIXED:
     break;
+  case CONCRETE_PLANNED:
+    concretize_planned_finalize(ctx, cfg, st);
+    break;
   default:
     fail(
       "! concretize_free_st: got unexpected concretization type: %s (%s)\n",
@@ -1,9 +1,31 @@
 #include "lib.h"
 
+/** the number of sets of ASIDs (and pagetables) a test uses
+ *
+ * the pipelined runner prepares the next batch while the current one runs,
+ * so needs a second set for it.
+ */
+static u64 asid_sets(void) {
+  return (LITMUS_RUNNER_TYPE == RUNNER_PIPELINED) ? 2 : 1;
+}
+
+/** the number of ASIDs each group of CPUs needs
+ */
+static u64 asids_per_group(const litmus_test_t* cfg, u64 runs_in_batch) {
+  if (cfg->requires & REQUIRES_PGTABLE)
+    return runs_in_batch * asid_sets();
+  else
+    return asid_sets();
+}
+
 static void sanity_check_test(const litmus_test_t* cfg, int no_runs, int runs_in_batch) {
-  /* we have 1+MAX_ASID ASIDs */
-  if ((cfg->requires & REQUIRES_PGTABLE) && runs_in_batch > 1 + MAX_ASID)
-    fail("cannot have more than the number of possible ASIDs (%ld) as runs in a batch with --pgtable.\n", 1 + MAX_ASID);
+  /* we have 1+MAX_ASID ASIDs, with ASID 0 reserved for the harness
+   * and with the pipelined runner, the next batch's ASIDs must not overlap the current one's */
+  if ((cfg->requires & REQUIRES_PGTABLE) && runs_in_batch * asid_sets() > MAX_ASID)
+    fail(
+      "cannot have more than the number of possible ASIDs (%ld) as runs in a batch with --pgtable.\n",
+      MAX_ASID / asid_sets()
+    );
 }
 
 void init_test_ctx(test_ctx_t* ctx, const litmus_test_t* cfg, int no_runs, int runs_in_batch) {
@@ -19,10 +41,8 @@ void init_test_ctx(test_ctx_t* ctx, const litmus_test_t* cfg, int no_runs, int r
   /* TODO: instead of asids/runs_in_batch everywhere, have proper batch type
    */
   bar_t* bars = ALLOC_MANY(bar_t, runs_in_batch);
-  run_idx_t* shuffled = ALLOC_MANY(run_idx_t, no_runs);
-  run_count_t* rev_lookup = ALLOC_MANY(run_count_t, no_runs);
   int* affinity = ALLOC_MANY(int, NO_CPUS);
-  u64** ptables = ALLOC_MANY(u64*, 1 + runs_in_batch);
+  u64** ptables = ALLOC_MANY(u64*, 1 + runs_in_batch * asid_sets());
 
   for (int v = 0; v < cfg->no_heap_vars; v++) {
     var_infos[v].values = ALLOC_MANY(u64*, no_runs);
@@ -48,13 +68,26 @@ void init_test_ctx(test_ctx_t* ctx, const litmus_test_t* cfg, int no_runs, int r
     for (reg_idx_t r = 0; r < cfg->no_regs; r++) {
       out_regs[r][i] = 0;
     }
-
-    shuffled[i] = i;
   }
 
-  shuffle(shuffled, sizeof(run_idx_t), no_runs);
-  for (run_count_t i = 0; i < no_runs; i++) {
-    rev_lookup[shuffled[i]] = i;
+  /* --shuffle=rand stores the shuffled order and its inverse,
+   * --shuffle=feistel computes them when needed (see count_to_run_index) */
+  run_idx_t* shuffled = NULL;
+  run_count_t* rev_lookup = NULL;
+  if (LITMUS_SHUFFLE_TYPE == SHUF_RAND) {
+    shuffled = ALLOC_MANY(run_idx_t, no_runs);
+    rev_lookup = ALLOC_MANY(run_count_t, no_runs);
+
+    for (run_idx_t i = 0; i < no_runs; i++) {
+      shuffled[i] = i;
+    }
+
+    shuffle(shuffled, sizeof(run_idx_t), no_runs);
+    for (run_count_t i = 0; i < no_runs; i++) {
+      rev_lookup[shuffled[i]] = i;
+    }
+  } else if (LITMUS_SHUFFLE_TYPE == SHUF_FEISTEL) {
+    init_permutation(&ctx->shuffle_perm, no_runs);
   }
 
   for (int i = 0; i < runs_in_batch; i++) {
@@ -67,16 +100,22 @@ void init_test_ctx(test_ctx_t* ctx, const litmus_test_t* cfg, int no_runs, int r
     affinity[i] = i;
   }
 
-  test_hist_t* hist = ALLOC_SIZED(sizeof(test_hist_t) + sizeof(test_result_t) * 200);
-  hist->allocated = 0;
-  hist->limit = 200;
-  test_result_t** lut = ALLOC_MANY(test_result_t*, hist->limit);
-  hist->lut = lut;
+  test_hist_t* hist = alloc_hist(cfg, 16);
+
+  /* each CPU collects the results for its share of a batch
+   * into its own histogram, before they get merged into the main one */
+  test_hist_t** staged_hists = ALLOC_MANY(test_hist_t*, NO_CPUS);
+  for (int i = 0; i < NO_CPUS; i++) {
+    staged_hists[i] = alloc_hist(cfg, 16);
+  }
 
-  for (int t = 0; t < hist->limit; t++) {
-    test_result_t* new_res = ALLOC_SIZED(sizeof(test_result_t) + sizeof(u64) * cfg->no_regs);
-    hist->results[t] = new_res;
-    lut[t] = NULL;
+  /* each thread records its own count of each event, for each run */
+  u64** pmu_counts = NULL;
+  if (NO_PMU_EVENTS > 0) {
+    pmu_counts = ALLOC_MANY(u64*, NO_PMU_EVENTS);
+    for (u64 e = 0; e < NO_PMU_EVENTS; e++) {
+      pmu_counts[e] = ALLOC_MANY(u64, no_runs * cfg->no_threads);
+    }
   }
 
   ctx->no_runs = no_runs;
@@ -92,16 +131,89 @@ void init_test_ctx(test_ctx_t* ctx, const litmus_test_t* cfg, int no_runs, int r
   ctx->batch_size = runs_in_batch;
   ctx->last_tick = 0;
   ctx->hist = hist;
+  ctx->staged_hists = staged_hists;
+  ctx->profile = ENABLE_PROFILE ? alloc_profile(NO_CPUS) : NULL;
+  ctx->pmu_counts = pmu_counts;
   ctx->ptables = ptables;
   ctx->current_run = 0;
   ctx->privileged_harness = 0;
   ctx->cfg = cfg;
   ctx->concretization_st = NULL;
+  ctx->batch_trackers = NULL;
+  ctx->tlbi_count_start = 0;
+  ctx->asid_rollovers = 0;
+  ctx->concretize_runs = 0;
+  ctx->concretize_attempts = 0;
+  ctx->concretize_max_attempts = 0;
+
+  /* by default, one group of all the CPUs */
+  ctx->group = 0;
+  ctx->no_groups = 1;
+  ctx->cpu_base = 0;
+  ctx->no_cpus = NO_CPUS;
+  ctx->asid_base = 0;
+  ctx->asid_range = MAX_ASID;
+  ctx->heap_region_lo = 0;
+  ctx->heap_region_hi = NO_TESTDATA_REGIONS;
 
   debug("initialized test ctx @ %p\n", ctx);
   DEBUG(DEBUG_ALLOCS, "now using %ld/%ld alloc chunks\n", valloc_alloclist_count_chunks(), NUM_ALLOC_CHUNKS);
 }
 
+u64 cfg_no_cpu_groups(const litmus_test_t* cfg, u64 no_cpus) {
+  if (!ENABLE_CPU_GROUPS)
+    return 1;
+
+  /* each group re-concretizes every batch, into its own heap regions
+   * so only the random concretizations (which can be confined to a set of regions) work.
+   * and fixed-location variables cannot be shared between groups */
+  if (LITMUS_CONCRETIZATION_TYPE != CONCRETE_RANDOM && LITMUS_CONCRETIZATION_TYPE != CONCRETE_PLANNED)
+    return 1;
+
+  for (int i = 0; i < cfg->no_init_states; i++) {
+    if (cfg->init_states[i]->type == TYPE_FIX)
+      return 1;
+  }
+
+  u64 no_groups = no_cpus / cfg->no_threads;
+
+  /* each group needs its own ASIDs ... */
+  no_groups = MIN(no_groups, MAX_ASID / asids_per_group(cfg, RUNS_IN_BATCH));
+
+  /* ... and at least 2 heap regions, as the concretizer never picks the last */
+  no_groups = MIN(no_groups, NO_TESTDATA_REGIONS / 2);
+
+  /* ... and at least one run */
+  no_groups = MIN(no_groups, NUMBER_OF_RUNS);
+
+  return MAX(no_groups, 1);
+}
+
+void set_ctx_cpu_group(test_ctx_t* ctx, u64 group, u64 no_groups) {
+  u64 regions_per_group = NO_TESTDATA_REGIONS / no_groups;
+
+  ctx->group = group;
+  ctx->no_groups = no_groups;
+  ctx->no_cpus = NO_CPUS / no_groups;
+  ctx->cpu_base = group * ctx->no_cpus;
+  ctx->asid_range = MAX_ASID / no_groups;
+  ctx->asid_base = group * ctx->asid_range;
+  ctx->heap_region_lo = group * regions_per_group;
+  ctx->heap_region_hi = ctx->heap_region_lo + regions_per_group;
+
+  debug(
+    "ctx %p is group %ld/%ld: CPUs %ld..%ld, ASIDs from %ld, regions %ld..%ld\n",
+    ctx,
+    group,
+    no_groups,
+    ctx->cpu_base,
+    ctx->cpu_base + ctx->no_cpus,
+    ctx->asid_base + 1,
+    ctx->heap_region_lo,
+    ctx->heap_region_hi
+  );
+}
+
 u64 ctx_pa(test_ctx_t* ctx, run_idx_t run, u64 va) {
   /* return the PA associated with the given va in a particular iteration */
   return (u64)vmm_pa(ptable_from_run(ctx, run), va);
@@ -171,6 +283,8 @@ run_count_t run_count_from_idx(test_ctx_t* ctx, run_idx_t idx) {
     return (run_count_t)idx;
   case SHUF_RAND:
     return ctx->shuffled_ixs_inverse[idx];
+  case SHUF_FEISTEL:
+    return (run_count_t)unpermute(&ctx->shuffle_perm, idx);
   default:
     fail("! unknown LITMUS_SHUFFLE_TYPE: %d/%s\n", LITMUS_SHUFFLE_TYPE, shuff_type_to_str(LITMUS_SHUFFLE_TYPE));
     return 0;
@@ -187,14 +301,51 @@ u64 ctx_initial_heap_value(test_ctx_t* ctx, run_idx_t idx) {
   return var_backing(var)->val;
 }
 
+/** the number of ASIDs each batch uses
+ *
+ * if pgtables are enabled, but the test does not require editing them
+ * then all the runs of a batch can share one
+ */
+static u64 asids_per_batch(test_ctx_t* ctx) {
+  if (ctx->cfg->requires & REQUIRES_PGTABLE)
+    return ctx->batch_size;
+  else
+    return 1;
+}
+
+static u64 batches_per_asid_generation(test_ctx_t* ctx) {
+  return ctx->asid_range / asids_per_batch(ctx);
+}
+
 u64 asid_from_run_count(test_ctx_t* ctx, run_count_t r) {
+  u64 batch = r / ctx->batch_size;
+  u64 asid = (batch % batches_per_asid_generation(ctx)) * asids_per_batch(ctx);
+
+  if (ctx->cfg->requires & REQUIRES_PGTABLE)
+    asid += r % ctx->batch_size;
+
   /* reserve ASID 0 for harness */
+  return ctx->asid_base + 1 + asid;
+}
+
+bool asid_generation_starts_at(test_ctx_t* ctx, run_count_t r) {
+  /* including the very first batch,
+   * as the previous test may have left entries in the TLB for any of the ASIDs */
+  return (r / ctx->batch_size) % batches_per_asid_generation(ctx) == 0;
+}
+
+/** the pagetables are re-used from batch to batch, independently of the ASIDs
+ *
+ * with more than one set of pagetables, consecutive batches alternate between them
+ * so a batch can be prepared while the one before it is still running
+ */
+u64 ptable_idx_from_run_count(test_ctx_t* ctx, run_count_t r) {
+  u64 set = (r / ctx->batch_size) % asid_sets();
+
   if (ctx->cfg->requires & REQUIRES_PGTABLE)
-    return 1 + (r % ctx->batch_size);
+    return set * ctx->batch_size + (r % ctx->batch_size);
   else
-    /* if pgtables are enabled, but the test does not require editing them
-     * allocate one test pagetable as ASID #1 */
-    return 1;
+    return set;
 }
 
 u64 asid_from_run(test_ctx_t* ctx, run_idx_t i) {
@@ -202,18 +353,29 @@ u64 asid_from_run(test_ctx_t* ctx, run_idx_t i) {
 }
 
 u64* ptable_from_run(test_ctx_t* ctx, run_idx_t i) {
-  run_count_t r = run_count_from_idx(ctx, i);
-  u64 asid = asid_from_run_count(ctx, r);
-  return ctx->ptables[asid];
+  return ctx->ptables[ptable_idx_from_run_count(ctx, run_count_from_idx(ctx, i))];
 }
 
 void free_test_ctx(test_ctx_t* ctx) {
-  for (int t = 0; t < ctx->hist->limit; t++) {
-    FREE(ctx->hist->results[t]);
+  for (int i = 0; i < NO_CPUS; i++) {
+    free_hist(ctx->staged_hists[i]);
   }
 
-  FREE(ctx->hist->lut);
-  FREE(ctx->hist);
+  FREE(ctx->staged_hists);
+  free_hist(ctx->hist);
+
+  if (ctx->profile != NULL)
+    free_profile(ctx->profile);
+
+  if (ctx->batch_trackers != NULL)
+    free_region_trackers(ctx->batch_trackers);
+
+  if (ctx->pmu_counts != NULL) {
+    for (u64 e = 0; e < NO_PMU_EVENTS; e++) {
+      FREE(ctx->pmu_counts[e]);
+    }
+    FREE(ctx->pmu_counts);
+  }
 
   for (int r = 0; r < ctx->cfg->no_regs; r++) {
     FREE(ctx->out_regs[r]);
@@ -224,8 +386,10 @@ void free_test_ctx(test_ctx_t* ctx) {
   }
 
   FREE((int*)ctx->affinity);
-  FREE(ctx->shuffled_ixs_inverse);
-  FREE(ctx->shuffled_ixs);
+  if (ctx->shuffled_ixs != NULL) {
+    FREE(ctx->shuffled_ixs_inverse);
+    FREE(ctx->shuffled_ixs);
+  }
   FREE((bar_t*)ctx->start_barriers);
   FREE((bar_t*)ctx->generic_cpu_barrier);
   FREE((bar_t*)ctx->generic_vcpu_barrier);
@@ -18,7 +18,22 @@ u64 var_page(litmus_test_run* data, const char* name) {
 
 /* pointers to table entries */
 
+/* with a smaller VA (e.g. --va-bits=39) the walk starts below level 0
+ * and there are no entries above VMM_START_LEVEL to point to */
+static void check_table_level(const char* name, int level) {
+  if (level < VMM_START_LEVEL) {
+    fail(
+      "! cannot get the level %d entry for \"%s\": with --va-bits=%ld the tables start at level %d\n",
+      level,
+      name,
+      VA_BITS,
+      VMM_START_LEVEL
+    );
+  }
+}
+
 u64* var_pte_level(litmus_test_run* data, const char* name, int level) {
+  check_table_level(name, level);
   return data->tt_entries[idx_from_varname(data->ctx, name)][level];
 }
 
@@ -41,6 +56,7 @@ u64* var_pte(litmus_test_run* data, const char* name) {
 /* initial table entry descriptors */
 
 u64 var_desc_level(litmus_test_run* data, const char* name, int level) {
+  check_table_level(name, level);
   return data->tt_descs[idx_from_varname(data->ctx, name)][level];
 }
 
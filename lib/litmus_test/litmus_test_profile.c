@@ -0,0 +1,173 @@
+#include "lib.h"
+
+const char* prof_phase_to_str(prof_phase_t phase) {
+  switch (phase) {
+  case PROF_ALLOCATE_BATCH:
+    return "allocate_batch";
+  case PROF_SETUP_RUN_DATA:
+    return "setup_run_data";
+  case PROF_PREPARE_CONTEXTS:
+    return "prepare_contexts";
+  case PROF_SWITCH_TO_TEST:
+    return "switch_to_test";
+  case PROF_BWAIT_START:
+    return "bwait_start";
+  case PROF_TEST:
+    return "test";
+  case PROF_RETURN_TO_HARNESS:
+    return "return_to_harness";
+  case PROF_BWAIT_RUN:
+    return "bwait_run";
+  case PROF_BWAIT_BATCH:
+    return "bwait_batch";
+  case PROF_END_OF_BATCH:
+    return "end_of_batch";
+  case PROF_CLEAN_RUN_DATA:
+    return "clean_run_data";
+  case PROF_THREAD:
+    return "thread";
+  default:
+    return "unknown";
+  }
+}
+
+test_profile_t* alloc_profile(u64 no_cpus) {
+  test_profile_t* profile = ALLOC_SIZED(sizeof(test_profile_t) + sizeof(prof_counter_t) * NUM_PROF_PHASES * no_cpus);
+  profile->no_cpus = no_cpus;
+  profile->use_pmu = arch_has_feature(FEAT_PMUv3);
+  return profile;
+}
+
+void free_profile(test_profile_t* profile) {
+  FREE(profile);
+}
+
+static prof_counter_t* prof_counter(test_profile_t* profile, u64 cpu, prof_phase_t phase) {
+  return &profile->counters[cpu * NUM_PROF_PHASES + phase];
+}
+
+u64 prof_now(test_profile_t* profile) {
+  /* per_cpu_setup enables the cycle counter, including from EL0 */
+  if (profile->use_pmu)
+    return read_sysreg(pmccntr_el0);
+  else
+    return read_clk();
+}
+
+static u64 bucket_of(u64 v) {
+  if (v < 16)
+    return v;
+
+  u64 shift = 63 - __builtin_clzl(v);
+  if (shift >= PROF_MAX_SHIFT)
+    return PROF_NUM_BUCKETS - 1;
+
+  u64 sub = (v >> (shift - 3)) & 0b111;
+  return 16 + (shift - 4) * 8 + sub;
+}
+
+/* the smallest value that goes in the bucket */
+static u64 bucket_value(u64 b) {
+  if (b < 16)
+    return b;
+
+  u64 shift = 4 + (b - 16) / 8;
+  u64 sub = (b - 16) % 8;
+  return (8 + sub) << (shift - 3);
+}
+
+void prof_record(test_profile_t* profile, u64 cpu, prof_phase_t phase, u64 start) {
+  u64 delta = prof_now(profile) - start;
+  prof_counter_t* counter = prof_counter(profile, cpu, phase);
+  counter->total += delta;
+  counter->count++;
+  counter->buckets[bucket_of(delta)]++;
+}
+
+void merge_profile(test_profile_t* into, test_profile_t* from) {
+  fail_on(into->no_cpus != from->no_cpus, "merge_profile: mismatched number of CPUs\n");
+
+  for (u64 i = 0; i < from->no_cpus * NUM_PROF_PHASES; i++) {
+    prof_counter_t* dst = &into->counters[i];
+    prof_counter_t* src = &from->counters[i];
+
+    dst->total += src->total;
+    dst->count += src->count;
+    for (u64 b = 0; b < PROF_NUM_BUCKETS; b++) {
+      dst->buckets[b] += src->buckets[b];
+    }
+  }
+}
+
+/** the value below which pct percent of the samples are
+ */
+static u64 percentile(u32* buckets, u64 count, u64 pct) {
+  u64 seen = 0;
+  u64 target = (count * pct + 99) / 100;
+
+  for (u64 b = 0; b < PROF_NUM_BUCKETS; b++) {
+    seen += buckets[b];
+    if (seen >= target && seen > 0)
+      return bucket_value(b);
+  }
+
+  return 0;
+}
+
+/* print x/total as a percentage to 1 decimal place */
+static void sprint_pct(STREAM* out, u64 x, u64 total) {
+  u64 permille = total == 0 ? 0 : (x * 1000) / total;
+  sprintf(out, "%ld.%ld%%", permille / 10, permille % 10);
+}
+
+void print_profile(test_ctx_t* ctx) {
+  test_profile_t* profile = ctx->profile;
+  u32 buckets[PROF_NUM_BUCKETS];
+
+  if (profile == NULL)
+    return;
+
+  /* the CPU time spent in the harness loop, over all CPUs */
+  u64 thread_total = 0;
+  for (u64 cpu = 0; cpu < profile->no_cpus; cpu++) {
+    thread_total += prof_counter(profile, cpu, PROF_THREAD)->total;
+  }
+
+  printf(
+    "# Profile %s (%s, summed over %ld CPUs)\n",
+    ctx->cfg->name,
+    profile->use_pmu ? "cycles" : "timer ticks",
+    profile->no_cpus
+  );
+
+  for (prof_phase_t phase = 0; phase < NUM_PROF_PHASES; phase++) {
+    u64 total = 0;
+    u64 count = 0;
+    valloc_memset(buckets, 0, sizeof(buckets));
+
+    for (u64 cpu = 0; cpu < profile->no_cpus; cpu++) {
+      prof_counter_t* counter = prof_counter(profile, cpu, phase);
+      total += counter->total;
+      count += counter->count;
+      for (u64 b = 0; b < PROF_NUM_BUCKETS; b++) {
+        buckets[b] += counter->buckets[b];
+      }
+    }
+
+    if (count == 0)
+      continue;
+
+    char pct[32];
+    sprint_pct(NEW_BUFFER(pct, 32), total, thread_total);
+    printf(
+      "#  %s: total=%ld (%s) count=%ld mean=%ld p50=%ld p99=%ld\n",
+      prof_phase_to_str(phase),
+      total,
+      pct,
+      count,
+      total / count,
+      percentile(buckets, count, 50),
+      percentile(buckets, count, 99)
+    );
+  }
+}
@@ -1,8 +1,8 @@
 #include "lib.h"
 
-static int matches(test_result_t* result, test_ctx_t* ctx, run_idx_t run) {
+static int matches(test_result_t* result, test_ctx_t* ctx, u64* values) {
   for (reg_idx_t reg = 0; reg < ctx->cfg->no_regs; reg++) {
-    if (result->values[reg] != ctx->out_regs[reg][run]) {
+    if (result->values[reg] != values[reg]) {
       return 0;
     }
   }
@@ -38,68 +38,163 @@ static int matches_interesting(test_hist_t* res, test_ctx_t* ctx, test_result_t*
   return 0;
 }
 
-static int ix_from_values(test_ctx_t* ctx, run_idx_t run) {
-  int val = 0;
-  for (reg_idx_t reg = 0; reg < ctx->cfg->no_regs; reg++) {
-    u64 v = ctx->out_regs[reg][run];
-    if (v < 4) {
-      val *= 4;
-      val += (int)(v % 4); /* must be less than 4 so fine ... */
-    } else {
-      return -1;
+/** hash of the packed register tuple
+ */
+static u64 hash_values(u64* values, u64 no_regs) {
+  u64 h = 0xcbf29ce484222325UL;
+  for (reg_idx_t reg = 0; reg < no_regs; reg++) {
+    h ^= values[reg];
+    h *= 0x100000001b3UL;
+    h ^= h >> 29;
+  }
+  return h;
+}
+
+/** find the slot in the hash table for the outcome values
+ * either the slot holding the matching result, or the empty one it should be inserted at
+ */
+static u64 find_slot(test_hist_t* res, test_ctx_t* ctx, u64* values) {
+  u64 mask = res->table_size - 1;
+  u64 slot = hash_values(values, ctx->cfg->no_regs) & mask;
+
+  while (res->table[slot] != 0 && !matches(hist_result(res, res->table[slot] - 1), ctx, values)) {
+    slot = (slot + 1) & mask;
+  }
+
+  return slot;
+}
+
+static void grow_table(test_hist_t* res, test_ctx_t* ctx) {
+  u64* old_table = res->table;
+  u64 old_size = res->table_size;
+
+  res->table_size = 2 * old_size;
+  res->table = ALLOC_MANY(u64, res->table_size);
+
+  for (u64 slot = 0; slot < old_size; slot++) {
+    if (old_table[slot] != 0) {
+      test_result_t* r = hist_result(res, old_table[slot] - 1);
+      res->table[find_slot(res, ctx, r->values)] = old_table[slot];
     }
   }
-  return val;
+
+  FREE(old_table);
 }
 
-static void add_results(test_hist_t* res, test_ctx_t* ctx, run_idx_t run) {
-  /* fast case: check lut */
-  test_result_t** lut = res->lut;
-  int ix = ix_from_values(ctx, run);
+/** with --pmu-events, the sum and sum of squares of each event
+ * over the runs with this outcome, stored after the values
+ */
+static u64* result_pmu_stats(test_ctx_t* ctx, test_result_t* r) {
+  return &r->values[ctx->cfg->no_regs];
+}
+
+static void add_pmu_stats(test_ctx_t* ctx, test_result_t* r, u64* pmu_stats) {
+  u64* stats = result_pmu_stats(ctx, r);
+  for (u64 s = 0; s < 2 * NO_PMU_EVENTS; s++) {
+    stats[s] += pmu_stats[s];
+  }
+}
+
+static void grow_results(test_hist_t* res) {
+  res->limit *= 2;
+  res->results = realloc(res->results, res->limit * res->result_size);
+}
 
-  if (ix != -1 && lut[ix] != NULL) {
-    lut[ix]->counter++;
+/** add count observations of the outcome values to the histogram
+ * along with the sums of their PMU event counts
+ */
+static void add_results(test_hist_t* res, test_ctx_t* ctx, u64* values, u64 count, u64* pmu_stats) {
+  u64 slot = find_slot(res, ctx, values);
+
+  if (res->table[slot] != 0) {
+    test_result_t* r = hist_result(res, res->table[slot] - 1);
+    r->counter += count;
+    add_pmu_stats(ctx, r, pmu_stats);
     return;
   }
 
-  /* otherwise, slow case: walk table for entry */
-  /* if already allocated */
-  int missing = 1;
-  for (int i = 0; i < res->allocated; i++) {
-    /* found a matching entry */
-    if (matches(res->results[i], ctx, run)) {
-      /* just increment its count */
-      missing = 0;
-      res->results[i]->counter++;
-      break;
-    }
+  /* not seen before, so insert it
+   * keeping the table at most half full so probe sequences stay short */
+  if (res->allocated == res->limit) {
+    grow_results(res);
   }
 
-  /* if not found, insert it */
-  if (missing) {
-    if (res->allocated >= res->limit) {
-      raise_to_el1(); /* can only abort at EL1 */
-      fail(
-        "overallocated results\n"
-        "this probably means the test had too many outcomes\n"
-      );
-    }
-    test_result_t* new_res = res->results[res->allocated];
+  if (2 * (res->allocated + 1) > res->table_size) {
+    grow_table(res, ctx);
+    slot = find_slot(res, ctx, values);
+  }
 
-    for (reg_idx_t reg = 0; reg < ctx->cfg->no_regs; reg++) {
-      new_res->values[reg] = ctx->out_regs[reg][run];
-    }
-    new_res->counter = 1;
-    new_res->is_relaxed = matches_interesting(res, ctx, new_res);
-    res->allocated++;
+  test_result_t* new_res = hist_result(res, res->allocated);
+  for (reg_idx_t reg = 0; reg < ctx->cfg->no_regs; reg++) {
+    new_res->values[reg] = values[reg];
+  }
+  new_res->counter = count;
+  new_res->is_relaxed = matches_interesting(res, ctx, new_res);
+  valloc_memset(result_pmu_stats(ctx, new_res), 0, sizeof(u64) * 2 * NO_PMU_EVENTS);
+  add_pmu_stats(ctx, new_res, pmu_stats);
+
+  res->allocated++;
+  res->table[slot] = res->allocated;
+}
+
+static void add_run_results(test_hist_t* res, test_ctx_t* ctx, run_idx_t run) {
+  u64 values[ctx->cfg->no_regs];
+  u64 pmu_stats[2 * NO_PMU_EVENTS + 1];
+
+  for (reg_idx_t reg = 0; reg < ctx->cfg->no_regs; reg++) {
+    values[reg] = ctx->out_regs[reg][run];
+  }
 
-    /* update LUT to point if future accesses should be fast */
-    if (ix != -1) {
-      lut[ix] = new_res;
+  /* the count of each event for the run is the sum over its threads */
+  for (u64 e = 0; e < NO_PMU_EVENTS; e++) {
+    u64 count = 0;
+    for (u64 t = 0; t < ctx->cfg->no_threads; t++) {
+      count += ctx->pmu_counts[e][run * ctx->cfg->no_threads + t];
     }
+    pmu_stats[2 * e] = count;
+    pmu_stats[2 * e + 1] = count * count;
+  }
+
+  add_results(res, ctx, values, 1, pmu_stats);
+}
+
+test_hist_t* alloc_hist(const litmus_test_t* cfg, u64 limit) {
+  test_hist_t* hist = ALLOC_ONE(test_hist_t);
+  hist->allocated = 0;
+  hist->limit = limit;
+  hist->result_size = sizeof(test_result_t) + sizeof(u64) * (cfg->no_regs + 2 * NO_PMU_EVENTS);
+  hist->results = ALLOC_SIZED(hist->result_size * limit);
+  hist->table_size = 2 * limit;
+  hist->table = ALLOC_MANY(u64, hist->table_size);
+  return hist;
+}
+
+void free_hist(test_hist_t* hist) {
+  FREE(hist->table);
+  FREE(hist->results);
+  FREE(hist);
+}
+
+void clear_hist(test_hist_t* hist) {
+  hist->allocated = 0;
+  valloc_memset(hist->table, 0, sizeof(u64) * hist->table_size);
+}
+
+void stage_results(test_ctx_t* ctx, test_hist_t* staging, run_count_t from, run_count_t to) {
+  for (run_count_t r = from; r < to; r++) {
+    add_run_results(staging, ctx, count_to_run_index(ctx, r));
   }
 }
 
+void merge_results(test_ctx_t* ctx, test_hist_t* into, test_hist_t* from) {
+  for (int t = 0; t < from->allocated; t++) {
+    test_result_t* r = hist_result(from, t);
+    add_results(into, ctx, r->values, r->counter, result_pmu_stats(ctx, r));
+  }
+
+  clear_hist(from);
+}
+
 static void print_single_result(test_ctx_t* ctx, run_count_t i) {
   printf("* ");
   for (reg_idx_t r = 0; r < ctx->cfg->no_regs; r++) {
@@ -114,13 +209,35 @@ static void print_single_result(test_ctx_t* ctx, run_count_t i) {
 void handle_new_result(test_ctx_t* ctx, run_idx_t idx, run_count_t r) {
   if (ENABLE_RESULTS_HIST) {
     test_hist_t* res = ctx->hist;
-    add_results(res, ctx, idx);
+    add_run_results(res, ctx, idx);
   } else {
     /* TODO: why does this use a run_count_t rather than the run_idx_t ? */
     print_single_result(ctx, r);
   }
 }
 
+/** print the mean and variance of each PMU event
+ * over the runs that saw this outcome
+ */
+static void print_pmu_stats(test_ctx_t* ctx, test_result_t* result) {
+  if (NO_PMU_EVENTS == 0)
+    return;
+
+  char line[1024];
+  STREAM* buf = NEW_BUFFER(line, 1024);
+  u64* stats = result_pmu_stats(ctx, result);
+
+  sprintf(buf, "#  pmu:");
+  for (u64 e = 0; e < NO_PMU_EVENTS; e++) {
+    u64 mean = stats[2 * e] / result->counter;
+    u64 var = stats[2 * e + 1] / result->counter - mean * mean;
+    sprintf(buf, " ");
+    sprint_pmu_event(buf, PMU_EVENTS[e]);
+    sprintf(buf, " mean=%ld var=%ld;", mean, var);
+  }
+  printf("%s\n", line);
+}
+
 static void print_test_header(const litmus_test_t* cfg) {
   static bool first_result = true;
 
@@ -163,23 +280,27 @@ static void print_results_original(test_hist_t* res, test_ctx_t* ctx) {
   int marked = 0;
   int no_sc_results_seen = 0;
   for (int r = 0; r < res->allocated; r++) {
-    int was_interesting = res->results[r]->is_relaxed;
+    test_result_t* result = hist_result(res, r);
+    int was_interesting = result->is_relaxed;
 
     if (ENABLE_RESULTS_OUTREG_PRINT) {
       for (reg_idx_t reg = 0; reg < ctx->cfg->no_regs; reg++) {
-        printf(" %s=%d ", ctx->cfg->reg_names[reg], res->results[r]->values[reg]);
+        printf(" %s=%d ", ctx->cfg->reg_names[reg], result->values[reg]);
       }
     }
 
     if (was_interesting) {
-      marked += res->results[r]->counter;
+      marked += result->counter;
       if (ENABLE_RESULTS_OUTREG_PRINT)
-        printf(" : %d *\n", res->results[r]->counter);
+        printf(" : %d *\n", result->counter);
     } else {
       no_sc_results_seen++;
       if (ENABLE_RESULTS_OUTREG_PRINT)
-        printf(" : %d\n", res->results[r]->counter);
+        printf(" : %d\n", result->counter);
     }
+
+    if (ENABLE_RESULTS_OUTREG_PRINT)
+      print_pmu_stats(ctx, result);
   }
   print_hash(ctx->cfg);
   printf("Observation %s: %d (of %d)\n", ctx->cfg->name, marked, ctx->no_runs);
@@ -203,24 +324,26 @@ static void print_results_herd(test_hist_t* res, test_ctx_t* ctx) {
   printf("Histogram (%d states)\n", res->allocated);
 
   for (int r = 0; r < res->allocated; r++) {
-    int was_interesting = res->results[r]->is_relaxed;
-    total_count += res->results[r]->counter;
+    test_result_t* result = hist_result(res, r);
+    int was_interesting = result->is_relaxed;
+    total_count += result->counter;
 
     char line[1024];
     STREAM* buf = NEW_BUFFER(line, 1024);
 
     if (ENABLE_RESULTS_OUTREG_PRINT) {
       char marker = was_interesting ? '*' : ':';
-      sprintf(buf, "%ld%c>", res->results[r]->counter, marker);
+      sprintf(buf, "%ld%c>", result->counter, marker);
       for (reg_idx_t reg = 0; reg < ctx->cfg->no_regs; reg++) {
         sprint_reg(buf, ctx->cfg->reg_names[reg], STYLE_HERDTOOLS);
-        sprintf(buf, "=%d;", res->results[r]->values[reg]);
+        sprintf(buf, "=%d;", result->values[reg]);
       }
       printf("%s\n", line);
+      print_pmu_stats(ctx, result);
     }
 
     if (was_interesting) {
-      marked += res->results[r]->counter;
+      marked += result->counter;
     } else {
       no_sc_results_seen++;
     }
@@ -4,7 +4,17 @@
 volatile u64 INITIAL_SEED = 0;
 volatile u64 SEED = 0;
 
-volatile lock_t __rnd_lock;
+/** each CPU has its own xoshiro256** generator
+ * so generating numbers needs no locking.
+ *
+ * each is on its own cache line, so the CPUs do not contend for them either.
+ */
+typedef struct
+{
+  u64 s[4];
+} __attribute__((aligned(64))) rand_state_t;
+
+static rand_state_t rand_states[MAX_CPUS];
 
 void init_seed(void) {
   u64 seed = read_clk();
@@ -12,31 +22,61 @@ void init_seed(void) {
   debug("set initial seed = 0x%lx\n", seed);
 }
 
-void reset_seed(void) {
-  LOCK(&__rnd_lock);
-  SEED = INITIAL_SEED;
-  UNLOCK(&__rnd_lock);
+static u64 splitmix64(u64* x) {
+  u64 z = (*x += 0x9e3779b97f4a7c15UL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+  return z ^ (z >> 31);
 }
 
+/** (re)seed every CPU's generator
+ *
+ * each CPU gets a different stream, but determined only by the seed and the CPU number
+ */
 void rand_seed(u64 seed) {
   debug("set seed = 0x%lx\n", seed);
   SEED = seed;
+
+  for (u64 cpu = 0; cpu < MAX_CPUS; cpu++) {
+    u64 x = seed + cpu * 0x632be59bd9b4e019UL;
+    for (int i = 0; i < 4; i++) {
+      rand_states[cpu].s[i] = splitmix64(&x);
+    }
+  }
+}
+
+void reset_seed(void) {
+  rand_seed(INITIAL_SEED);
+}
+
+static u64 rotl(u64 x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+static u64 xoshiro256ss(rand_state_t* st) {
+  u64* s = st->s;
+  u64 result = rotl(s[1] * 5, 7) * 9;
+  u64 t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+
+  return result;
 }
 
 u64 randn(void) {
-  LOCK(&__rnd_lock);
-  u64 st = 1;
+  return xoshiro256ss(&rand_states[get_cpu()]);
+}
 
-  for (int i = 0; i < 64; i++) {
-    if (i % 7 == 0 || i % 13 == 0) {
-      int x = (SEED >> i) & 0x1;
-      st = st ^ x;
-    }
+void randn_fill(u64* out, u64 n) {
+  rand_state_t* st = &rand_states[get_cpu()];
+  for (u64 i = 0; i < n; i++) {
+    out[i] = xoshiro256ss(st);
   }
-  u64 new_seed = (SEED << 1) + st;
-  SEED = new_seed;
-  UNLOCK(&__rnd_lock);
-  return new_seed;
 }
 
 u64 randrange(u64 low, u64 high) {
@@ -52,14 +92,83 @@ u64 randrange(u64 low, u64 high) {
 
 void shuffle(void* p, u64 szof, u64 n) {
   char* arr = p;
+  u64 rs[64];
 
   for (int i = 0; i < n; i++) {
     char datum[szof];
-    u64 x = (randn() % n) * szof;
-    u64 y = (randn() % n) * szof;
+
+    if (i % 32 == 0)
+      randn_fill(rs, 64);
+
+    u64 x = (rs[2 * (i % 32)] % n) * szof;
+    u64 y = (rs[2 * (i % 32) + 1] % n) * szof;
 
     valloc_memcpy(datum, arr + x, szof);
     valloc_memcpy(arr + x, arr + y, szof);
     valloc_memcpy(arr + y, datum, szof);
   }
 }
+
+void init_permutation(permutation_t* perm, u64 n) {
+  u64 bits = 2;
+  while (bits < 64 && (1UL << bits) < n) {
+    bits += 2;
+  }
+
+  perm->n = n;
+  perm->half_bits = bits / 2;
+  for (int r = 0; r < PERMUTATION_ROUNDS; r++) {
+    perm->keys[r] = randn();
+  }
+}
+
+/* the round function, any function of the half-block will do */
+static u64 feistel_round(u64 x, u64 key, u64 mask) {
+  x ^= key;
+  x *= 0x9e3779b97f4a7c15UL;
+  x ^= x >> 29;
+  return x & mask;
+}
+
+static u64 feistel(permutation_t* perm, u64 x) {
+  u64 mask = (1UL << perm->half_bits) - 1;
+  u64 l = x >> perm->half_bits;
+  u64 r = x & mask;
+
+  for (int i = 0; i < PERMUTATION_ROUNDS; i++) {
+    u64 t = l ^ feistel_round(r, perm->keys[i], mask);
+    l = r;
+    r = t;
+  }
+
+  return (l << perm->half_bits) | r;
+}
+
+static u64 feistel_inverse(permutation_t* perm, u64 x) {
+  u64 mask = (1UL << perm->half_bits) - 1;
+  u64 l = x >> perm->half_bits;
+  u64 r = x & mask;
+
+  for (int i = PERMUTATION_ROUNDS - 1; i >= 0; i--) {
+    u64 t = r ^ feistel_round(l, perm->keys[i], mask);
+    r = l;
+    l = t;
+  }
+
+  return (l << perm->half_bits) | r;
+}
+
+/* the domain is less than 4n, so this takes fewer than 4 steps on average */
+u64 permute(permutation_t* perm, u64 i) {
+  do {
+    i = feistel(perm, i);
+  } while (i >= perm->n);
+  return i;
+}
+
+u64 unpermute(permutation_t* perm, u64 i) {
+  do {
+    i = feistel_inverse(perm, i);
+  } while (i >= perm->n);
+  return i;
+}
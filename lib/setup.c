@@ -145,6 +145,7 @@ void setup(char* fdtloc) {
 
   verbose("version: %s\n", version_string());
   verbose("build: %s\n", build_string());
+  verbose("cpus: %ld\n", NO_CPUS);
 
   char* output = "";
   if (DEBUG) {
@@ -170,11 +171,27 @@ void setup(char* fdtloc) {
   verbose("timing: %ld\n", ENABLE_PERF_COUNTS);
   verbose("no_runs: %ld\n", NUMBER_OF_RUNS);
   verbose("batch_size: %ld\n", RUNS_IN_BATCH);
+  verbose("asid_bits: %ld\n", ASID_SIZE);
   verbose("tlbsync: %s\n", sync_type_to_str(LITMUS_SYNC_TYPE));
   verbose("aff: %s\n", aff_type_to_str(LITMUS_AFF_TYPE));
   verbose("shuffle: %s\n", shuff_type_to_str(LITMUS_SHUFFLE_TYPE));
   verbose("concretize: %s\n", concretize_type_to_str(LITMUS_CONCRETIZATION_TYPE));
   verbose("runner: %s\n", runner_type_to_str(LITMUS_RUNNER_TYPE));
+  verbose("barrier: %s\n", barrier_type_to_str(BARRIER_TYPE));
+  verbose("cpu_groups: %ld\n", ENABLE_CPU_GROUPS);
+  verbose("profile: %ld\n", ENABLE_PROFILE);
+  verbose("global_harness: %ld\n", ENABLE_GLOBAL_HARNESS);
+  verbose("va_bits: %ld\n", VA_BITS);
+  verbose("testdata_regions: %ld\n", NO_TESTDATA_REGIONS);
+
+  char pmu_events[1024];
+  STREAM* pmu_buf = NEW_BUFFER(pmu_events, 1024);
+  pmu_events[0] = '\0';
+  for (u64 i = 0; i < NO_PMU_EVENTS; i++) {
+    sprint_pmu_event(pmu_buf, PMU_EVENTS[i]);
+    sprintf(pmu_buf, " ");
+  }
+  verbose("pmu_events: %s\n", pmu_events);
 
   /* sanity check */
   if (ENABLE_PERF_COUNTS && !arch_has_feature(FEAT_PMUv3)) {
@@ -184,6 +201,24 @@ void setup(char* fdtloc) {
     );
   }
 
+  if (ENABLE_PGTABLE && NO_TESTDATA_REGIONS < 2) {
+    fail("not enough memory for the test data, only %ld bytes\n", TOP_OF_TESTDATA - BOT_OF_TESTDATA);
+  }
+
+  if (TESTDATA_MMAP_BASE + TESTDATA_MMAP_SIZE > (1UL << VA_BITS)) {
+    fail("[--va-bits] %ld bits of VA is not enough to map the test data, suggest increasing --va-bits\n", VA_BITS);
+  }
+
+  if (NO_PMU_EVENTS > 0) {
+    if (!arch_has_feature(FEAT_PMUv3)) {
+      fail("[--pmu-events] Cannot count PMU events without FEAT_PMU, suggest removing --pmu-events\n");
+    }
+
+    if (NO_PMU_EVENTS > pmu_no_counters()) {
+      fail("[--pmu-events] Asked for %ld events but this CPU only has %ld counters\n", NO_PMU_EVENTS, pmu_no_counters());
+    }
+  }
+
   ensure_cpus_on();
 }
 
@@ -259,6 +294,10 @@ begin_el1:
 
     vmm_set_id_translation(vmm_pgtable);
     debug("set new pgtable for CPU%d\n", cpu);
+
+    /* allocated at boot, so that restoring the pagetable space after each test does not free it */
+    if (cpu == 0)
+      vmm_alloc_test_pgtable_template();
   }
 
   /* enable virtual/physical timers */
@@ -63,9 +63,9 @@ int ctoi_hex(char c) {
   if (c >= '0' && c <= '9') {
     return ((int)c - '0');
   } else if (c >= 'a' && c <= 'f') {
-    return ((int)c - 'a');
+    return ((int)c - 'a' + 10);
   } else if (c >= 'A' && c <= 'F') {
-    return ((int)c - 'A');
+    return ((int)c - 'A' + 10);
   }
 
   return 0;
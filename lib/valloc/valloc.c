@@ -12,7 +12,11 @@ void init_valloc(void) {
                           .freelist = NULL,
                           .chunks = { { 0, 0, NULL, NULL } },
                           .chunk_alloc_list = NULL,
-                          .chunk_unalloc_list = NULL };
+                          .chunk_unalloc_list = NULL,
+                          .slab_classes = { { 0 } },
+                          .slab_pages = { 0 },
+                          .slab_top = ALIGN_UP(BOT_OF_HEAP, PAGE_SHIFT),
+                          .slab_free_pages = NULL };
 
   /* we fill chunk_unalloc_list */
   for (u64 i = 0; i < NUM_ALLOC_CHUNKS; i++) {
@@ -30,10 +34,17 @@ void init_valloc(void) {
   mem.chunk_unalloc_list = &mem.chunks[0];
 }
 
+u64 valloc_alloc_size(void* p) {
+  u64 size = valloc_slab_size(p);
+  if (size != 0)
+    return size;
+
+  return valloc_alloclist_find_alloc_chunk(&mem, (u64)p)->size;
+}
+
 void* realloc(void* p, u64 new_size) {
   char* new_p = alloc(new_size);
-  valloc_alloc_chunk* chk = valloc_alloclist_find_alloc_chunk(&mem, (u64)p);
-  valloc_memcpy(new_p, p, chk->size);
+  valloc_memcpy(new_p, p, valloc_alloc_size(p));
   free(p);
   return new_p;
 }
@@ -60,7 +71,7 @@ static u64 next_largest_pow2(u64 i) {
   return (1UL << hi);
 }
 
-static void* __alloc_with_alignment(u64 size, u64 alignment) {
+static void* __valloc_alloc_chunk(u64 size, u64 alignment) {
   valloc_free_chunk* free_chunk = valloc_freelist_find_best(size, alignment);
   if (free_chunk != NULL) {
     DEBUG(
@@ -72,15 +83,15 @@ static void* __alloc_with_alignment(u64 size, u64 alignment) {
     return free_chunk;
   }
 
-  if (size > mem.top - BOT_OF_HEAP) {
-    fail("! error: cannot allocate %p bytes, only %p bytes left to allocate\n", size, mem.top - BOT_OF_HEAP);
+  if (size > mem.top - mem.slab_top) {
+    fail("! error: cannot allocate %p bytes, only %p bytes left to allocate\n", size, mem.top - mem.slab_top);
   }
 
   /* move 'top' down and align to size */
   u64 allocated_space_vaddr = ALIGN_POW2(mem.top - size, alignment);
   u64 new_top = allocated_space_vaddr;
 
-  if (new_top < BOT_OF_HEAP) {
+  if (new_top < mem.slab_top) {
     puts("!! alloc_with_alignment: no free space\n");
     abort();
   }
@@ -106,7 +117,9 @@ void* alloc_with_alignment(u64 size, u64 alignment) {
     alignment = next_largest_pow2(sizeof(valloc_alloc_chunk));
   }
 
-  void* ptr = __alloc_with_alignment(size, alignment);
+  void* ptr = valloc_slab_alloc(size, alignment);
+  if (ptr == NULL)
+    ptr = __valloc_alloc_chunk(size, alignment);
 
   /* always zero */
   valloc_memset(ptr, 0, size);
@@ -133,7 +146,9 @@ void* alloc(u64 size) {
   }
 
   LOCK(&__valloc_lock);
-  void* ptr = __alloc_with_alignment(size, alignment);
+  void* ptr = valloc_slab_alloc(size, alignment);
+  if (ptr == NULL)
+    ptr = __valloc_alloc_chunk(size, alignment);
 
   /* always zero */
   valloc_memset(ptr, 0, size);
@@ -142,8 +157,7 @@ void* alloc(u64 size) {
   return ptr;
 }
 
-void free(void* p) {
-  LOCK(&__valloc_lock);
+static void __valloc_free_chunk(void* p) {
   valloc_alloc_chunk* chk = valloc_alloclist_find_alloc_chunk(&mem, (u64)p);
   if (!chk) {
     fail("! err: free %p (double free?)\n", p);
@@ -153,6 +167,12 @@ void free(void* p) {
   valloc_alloclist_dealloc(&mem, (u64)p);
   valloc_freelist_allocate_free_chunk((u64)p, size);
   valloc_freelist_compact_chunk(mem.freelist);
+}
+
+void free(void* p) {
+  LOCK(&__valloc_lock);
+  if (!valloc_slab_free(p))
+    __valloc_free_chunk(p);
   UNLOCK(&__valloc_lock);
 }
 
@@ -201,6 +221,10 @@ void valloc_memset(void* p, u8 value, u64 size) {
 int valloc_is_free(void* p) {
   u64 va = (u64)p;
 
+  if (valloc_slab_size(p) != 0) {
+    return 0;
+  }
+
   if (va < mem.top) {
     return 1;
   }
@@ -232,6 +256,10 @@ u64 valloc_free_size(void) {
     chk = chk->next;
   }
 
+  /* the slab pages below slab_top with nothing allocated in them
+   * still count as free */
+  used_space += valloc_slab_used_space();
+
   return (top - BOT_OF_HEAP) - used_space;
 }
 
@@ -30,6 +30,9 @@ void valloc_ptable_restore(valloc_ptable_mem checkpoint) {
   LOCK(&__valloc_pgtable_lock);
   ptable_mem = checkpoint;
   UNLOCK(&__valloc_pgtable_lock);
+
+  /* the freed tables will be re-used for other tables */
+  vmm_walk_cache_flush();
 }
 
 /** allocate one zero'd page of memory
@@ -0,0 +1,240 @@
+#include "lib.h"
+
+/* slab allocator for small objects
+ * see valloc_generic.h
+ */
+
+static u64 first_object_offset(u64 shift) {
+  return ALIGN_UP(sizeof(valloc_slab), shift);
+}
+
+static u64 objects_per_slab(u64 shift) {
+  return (PAGE_SIZE - first_object_offset(shift)) >> shift;
+}
+
+static valloc_slab_class* slab_class(u64 shift) {
+  return &mem.slab_classes[shift - SLAB_MIN_SHIFT];
+}
+
+/** the index of the heap page pg in mem.slab_pages
+ * returns false if it is outside the range that can hold slabs
+ */
+static bool slab_page_index(u64 pg, u64* ix) {
+  u64 bot = ALIGN_TO(BOT_OF_HEAP, PAGE_SHIFT);
+  if (pg < bot)
+    return false;
+
+  *ix = (pg - bot) >> PAGE_SHIFT;
+  return *ix < SLAB_MAX_HEAP_PAGES;
+}
+
+/** the slab p was allocated from, or NULL if p is not in a slab
+ */
+static valloc_slab* slab_of(void* p) {
+  u64 pg = ALIGN_TO((u64)p, PAGE_SHIFT);
+  u64 ix;
+
+  if (!slab_page_index(pg, &ix))
+    return NULL;
+
+  if (((mem.slab_pages[ix / 64] >> (ix % 64)) & 1) == 0)
+    return NULL;
+
+  return (valloc_slab*)pg;
+}
+
+static void set_slab_page(valloc_slab* slab, bool is_slab) {
+  u64 ix;
+  slab_page_index((u64)slab, &ix);
+
+  if (is_slab)
+    mem.slab_pages[ix / 64] |= 1UL << (ix % 64);
+  else
+    mem.slab_pages[ix / 64] &= ~(1UL << (ix % 64));
+}
+
+static void push_partial(valloc_slab_class* cls, valloc_slab* slab) {
+  slab->prev = NULL;
+  slab->next = cls->partial;
+  SET(cls->partial, prev, slab);
+  cls->partial = slab;
+}
+
+static void remove_partial(valloc_slab_class* cls, valloc_slab* slab) {
+  if (slab->prev)
+    slab->prev->next = slab->next;
+  else
+    cls->partial = slab->next;
+
+  SET(slab->next, prev, slab->prev);
+  slab->prev = NULL;
+  slab->next = NULL;
+}
+
+/** take a page for a new slab
+ * either one given back by an earlier slab, or the next one up from mem.slab_top
+ * returns NULL if there is no page left that can hold a slab
+ */
+static valloc_slab* take_slab_page(void) {
+  valloc_slab* slab = mem.slab_free_pages;
+  if (slab != NULL) {
+    mem.slab_free_pages = slab->next;
+    return slab;
+  }
+
+  u64 ix;
+  if (mem.slab_top + PAGE_SIZE > mem.top || !slab_page_index(mem.slab_top, &ix))
+    return NULL;
+
+  slab = (valloc_slab*)mem.slab_top;
+  mem.slab_top += PAGE_SIZE;
+  return slab;
+}
+
+/** give back the page of a slab with nothing allocated in it
+ */
+static void release_slab(valloc_slab_class* cls, valloc_slab* slab) {
+  set_slab_page(slab, false);
+  cls->no_slabs--;
+
+  if ((u64)slab + PAGE_SIZE == mem.slab_top) {
+    mem.slab_top -= PAGE_SIZE;
+  } else {
+    slab->next = mem.slab_free_pages;
+    mem.slab_free_pages = slab;
+  }
+
+  DEBUG(DEBUG_ALLOC_META, "released slab for %ld B objects @ %p\n", 1UL << slab->shift, slab);
+}
+
+/** take a new page for a slab of objects of size 2^shift
+ * returns NULL if there is no page left that can hold a slab
+ */
+static valloc_slab* new_slab(u64 shift) {
+  valloc_slab* slab = take_slab_page();
+  if (slab == NULL)
+    return NULL;
+
+  u64 no_objs = objects_per_slab(shift);
+  slab->shift = shift;
+  slab->no_used = 0;
+  for (u64 w = 0; w < 2; w++) {
+    u64 first = w * 64;
+    if (no_objs <= first)
+      slab->used[w] = ~0UL;
+    else if (no_objs >= first + 64)
+      slab->used[w] = 0;
+    else
+      slab->used[w] = ~0UL << (no_objs - first);
+  }
+
+  set_slab_page(slab, true);
+
+  valloc_slab_class* cls = slab_class(shift);
+  cls->no_slabs++;
+  cls->max_slabs = MAX(cls->max_slabs, cls->no_slabs);
+  push_partial(cls, slab);
+
+  DEBUG(DEBUG_ALLOC_META, "new slab for %ld B objects @ %p\n", 1UL << shift, slab);
+  return slab;
+}
+
+void* valloc_slab_alloc(u64 size, u64 alignment) {
+  /* objects are aligned to their size,
+   * so the class must be big enough for both */
+  u64 need = MAX(size, alignment);
+  if (need > SLAB_MAX_SIZE)
+    return NULL;
+
+  u64 shift = need <= SLAB_MIN_SIZE ? SLAB_MIN_SHIFT : 64 - __builtin_clzl(need - 1);
+  valloc_slab_class* cls = slab_class(shift);
+
+  valloc_slab* slab = cls->partial;
+  if (slab == NULL && cls->empty != NULL) {
+    slab = cls->empty;
+    cls->empty = NULL;
+    push_partial(cls, slab);
+  } else if (slab == NULL) {
+    slab = new_slab(shift);
+    if (slab == NULL)
+      return NULL;
+  }
+
+  /* a slab on the partial list always has a free object */
+  u64 w = ~slab->used[0] != 0 ? 0 : 1;
+  u64 obj = w * 64 + __builtin_ctzl(~slab->used[w]);
+  slab->used[w] |= 1UL << (obj % 64);
+  slab->no_used++;
+
+  if (slab->no_used == objects_per_slab(shift))
+    remove_partial(cls, slab);
+
+  cls->no_allocs++;
+  cls->no_live++;
+
+  return (void*)((u64)slab + first_object_offset(shift) + (obj << shift));
+}
+
+bool valloc_slab_free(void* p) {
+  valloc_slab* slab = slab_of(p);
+  if (slab == NULL)
+    return false;
+
+  u64 shift = slab->shift;
+  u64 offs = (u64)p - (u64)slab;
+
+  if (offs < first_object_offset(shift) || !IS_ALIGNED(offs - first_object_offset(shift), shift)) {
+    fail("! err: free %p is not the start of a %ld B slab object\n", p, 1UL << shift);
+  }
+
+  u64 obj = (offs - first_object_offset(shift)) >> shift;
+  u64 bit = 1UL << (obj % 64);
+  if ((slab->used[obj / 64] & bit) == 0) {
+    fail("! err: free %p (double free?)\n", p);
+  }
+
+  valloc_slab_class* cls = slab_class(shift);
+  bool was_full = slab->no_used == objects_per_slab(shift);
+
+  slab->used[obj / 64] &= ~bit;
+  slab->no_used--;
+  cls->no_frees++;
+  cls->no_live--;
+
+  if (slab->no_used == 0) {
+    /* keep one empty slab per class,
+     * so that allocating and freeing one object in a loop does not take and give back a page each time */
+    if (!was_full)
+      remove_partial(cls, slab);
+
+    if (cls->empty == NULL)
+      cls->empty = slab;
+    else
+      release_slab(cls, slab);
+  } else if (was_full) {
+    push_partial(cls, slab);
+  }
+
+  return true;
+}
+
+u64 valloc_slab_used_space(void) {
+  u64 no_slabs = 0;
+
+  for (u64 i = 0; i < NUM_SLAB_CLASSES; i++) {
+    valloc_slab_class* cls = &mem.slab_classes[i];
+    no_slabs += cls->no_slabs;
+    if (cls->empty != NULL)
+      no_slabs--;
+  }
+
+  return no_slabs * PAGE_SIZE;
+}
+
+u64 valloc_slab_size(void* p) {
+  valloc_slab* slab = slab_of(p);
+  if (slab == NULL)
+    return 0;
+
+  return 1UL << slab->shift;
+}
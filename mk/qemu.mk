@@ -1,6 +1,9 @@
 # amount of memory for QEMU to allocate
 QEMU_MEM = 1G
 
+# number of CPUs to give QEMU (the raspi3 machine always has 4)
+QEMU_CPUS ?= 4
+
 # default HOST uses the gic
 # otherwise can pass no-gic to use emulated irqchip
 HOST = gic
@@ -11,7 +14,7 @@ RUN_CMD_HOST_GIC = 	\
 		-device virtio-serial-device -device virtconsole \
 		-display none -serial stdio \
 		-m $(QEMU_MEM) \
-		-kernel $(OUT_NAME) -smp 4 -append "$$*"
+		-kernel $(OUT_NAME) -smp $(QEMU_CPUS) -append "$$*"
 
 RUN_CMD_HOST_NO_GIC = 	\
 	$(QEMU) \
@@ -19,7 +22,7 @@ RUN_CMD_HOST_NO_GIC = 	\
 		-device virtio-serial-device -device virtconsole \
 		-display none -serial stdio \
 		-m $(QEMU_MEM) \
-		-kernel $(OUT_NAME) -smp 4 -append "$$*"
+		-kernel $(OUT_NAME) -smp $(QEMU_CPUS) -append "$$*"
 
 RUN_CMD_HOST = \
 	$(if $(filter gic,$(HOST)),$(RUN_CMD_HOST_GIC),\
@@ -33,7 +36,7 @@ RUN_CMD_LOCAL_VIRT = 	\
 		-device virtio-serial-device \
 		-display none -serial stdio \
 		-m $(QEMU_MEM) \
-		-kernel $(OUT_NAME) -smp 4 -append "$$*"
+		-kernel $(OUT_NAME) -smp $(QEMU_CPUS) -append "$$*"
 
 RUN_CMD_LOCAL_RPI3 = 	\
 	$(QEMU) \
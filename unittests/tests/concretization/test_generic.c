@@ -13,6 +13,7 @@ u64* __var(test_ctx_t* ctx, run_idx_t r, const char* varname) {
 
 UNIT_TEST_IF(test_concretization_linear_default_diff_pages, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_default_diff_pages, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_default_diff_pages, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_default_diff_pages(concretize_type_t conc_type) {
   litmus_test_t test = {
     "test",
@@ -50,8 +51,13 @@ void test_concretization_random_default_diff_pages(void) {
   __test_concretization_default_diff_pages(CONCRETE_RANDOM);
 }
 
+void test_concretization_planned_default_diff_pages(void) {
+  __test_concretization_default_diff_pages(CONCRETE_PLANNED);
+}
+
 UNIT_TEST_IF(test_concretization_linear_own_pmd, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_own_pmd, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_own_pmd, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_own_pmd(concretize_type_t conc_type) {
   litmus_test_t test = {
     "test",
@@ -92,8 +98,13 @@ void test_concretization_random_own_pmd(void) {
   __test_concretization_own_pmd(CONCRETE_RANDOM);
 }
 
+void test_concretization_planned_own_pmd(void) {
+  __test_concretization_own_pmd(CONCRETE_PLANNED);
+}
+
 UNIT_TEST_IF(test_concretization_linear_same_page, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_same_page, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_same_page, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_same_page(concretize_type_t conc_type) {
   litmus_test_t test = {
     "test",
@@ -129,8 +140,13 @@ void test_concretization_random_same_page(void) {
   __test_concretization_same_page(CONCRETE_RANDOM);
 }
 
+void test_concretization_planned_same_page(void) {
+  __test_concretization_same_page(CONCRETE_PLANNED);
+}
+
 UNIT_TEST_IF(test_concretization_linear_separate_roots, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_separate_roots, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_separate_roots, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_separate_roots(concretize_type_t conc_type) {
   litmus_test_t test = { "test",
                          0,
@@ -173,8 +189,13 @@ void test_concretization_random_separate_roots(void) {
   __test_concretization_separate_roots(CONCRETE_RANDOM);
 }
 
+void test_concretization_planned_separate_roots(void) {
+  __test_concretization_separate_roots(CONCRETE_PLANNED);
+}
+
 UNIT_TEST_IF(test_concretization_linear_aliased, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_aliased, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_aliased, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_aliased(concretize_type_t conc_type) {
   litmus_test_t test = { "test",
                          0,
@@ -207,8 +228,13 @@ void test_concretization_random_aliased(void) {
   __test_concretization_aliased(CONCRETE_RANDOM);
 }
 
+void test_concretization_planned_aliased(void) {
+  __test_concretization_aliased(CONCRETE_PLANNED);
+}
+
 UNIT_TEST_IF(test_concretization_linear_unrelated_aliased, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_unrelated_aliased, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_unrelated_aliased, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_unrelated_aliased(concretize_type_t conc_type) {
   litmus_test_t test = { "test",
                          0,
@@ -243,8 +269,13 @@ void test_concretization_random_unrelated_aliased(void) {
   __test_concretization_unrelated_aliased(CONCRETE_RANDOM);
 }
 
+void test_concretization_planned_unrelated_aliased(void) {
+  __test_concretization_unrelated_aliased(CONCRETE_PLANNED);
+}
+
 UNIT_TEST_IF(test_concretization_linear_unmapped, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_unmapped, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_unmapped, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_unmapped(concretize_type_t conc_type) {
   litmus_test_t test = {
     "test",
@@ -286,8 +317,13 @@ void test_concretization_random_unmapped(void) {
   __test_concretization_unmapped(CONCRETE_RANDOM);
 }
 
+void test_concretization_planned_unmapped(void) {
+  __test_concretization_unmapped(CONCRETE_PLANNED);
+}
+
 UNIT_TEST_IF(test_concretization_linear_twopage, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_twopage, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_twopage, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_twopage(concretize_type_t conc_type) {
   litmus_test_t test = {
     "test",
@@ -338,8 +374,13 @@ void test_concretization_random_twopage(void) {
   __test_concretization_twopage(CONCRETE_RANDOM);
 }
 
+void test_concretization_planned_twopage(void) {
+  __test_concretization_twopage(CONCRETE_PLANNED);
+}
+
 UNIT_TEST_IF(test_concretization_linear_relpmdoverlap, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_relpmdoverlap, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_relpmdoverlap, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_relpmdoverlap(concretize_type_t conc_type) {
   litmus_test_t test = {
     "test",
@@ -386,8 +427,13 @@ void test_concretization_random_relpmdoverlap(void) {
   __test_concretization_relpmdoverlap(CONCRETE_RANDOM);
 }
 
+void test_concretization_planned_relpmdoverlap(void) {
+  __test_concretization_relpmdoverlap(CONCRETE_PLANNED);
+}
+
 UNIT_TEST_IF(test_concretization_linear_multi_pmd_pin, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
 UNIT_TEST_IF(test_concretization_random_multi_pmd_pin, ENABLE_UNITTESTS_CONCRETIZATION_TEST_RANDOM)
+UNIT_TEST_IF(test_concretization_planned_multi_pmd_pin, ENABLE_UNITTESTS_CONCRETIZATION_TEST_PLANNED)
 void __test_concretization_multi_pmd_pin(concretize_type_t conc_type) {
   litmus_test_t test = {
     "test",
@@ -448,4 +494,8 @@ void test_concretization_linear_multi_pmd_pin(void) {
 
 void test_concretization_random_multi_pmd_pin(void) {
   __test_concretization_multi_pmd_pin(CONCRETE_RANDOM);
-}
\ No newline at end of file
+}
+
+void test_concretization_planned_multi_pmd_pin(void) {
+  __test_concretization_multi_pmd_pin(CONCRETE_PLANNED);
+}
@@ -0,0 +1,114 @@
+#include "lib.h"
+#include "testlib.h"
+
+#define SIZE_OF_TEST 100
+#define BATCH_SIZE 4
+
+UNIT_TEST_IF(test_concretization_linear_batch_distinct_slots, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
+void test_concretization_linear_batch_distinct_slots(void) {
+  litmus_test_t test = {
+    "test",
+    0,
+    NULL,
+    2,
+    (const char*[]){ "x", "y" },
+    0,
+    NULL,
+    INIT_STATE(
+      4, INIT_VAR(x, 0), INIT_VAR(y, 0), INIT_REGION_OWN(x, REGION_OWN_PAGE), INIT_REGION_OWN(y, REGION_OWN_PAGE),
+    )
+  };
+
+  test_ctx_t ctx;
+
+  init_test_ctx(&ctx, &test, SIZE_OF_TEST, BATCH_SIZE);
+  initialize_regions(&ctx.heap_memory);
+  void* st = concretize_init(CONCRETE_LINEAR, &ctx, ctx.cfg, ctx.no_runs);
+  concretize(CONCRETE_LINEAR, &ctx, ctx.cfg, st, ctx.no_runs);
+
+  /* no two runs of the same batch share a page */
+  for (run_count_t r = 0; r < ctx.no_runs; r++) {
+    run_idx_t i = count_to_run_index(&ctx, r);
+    run_count_t batch_end = MIN((r / BATCH_SIZE + 1) * BATCH_SIZE, ctx.no_runs);
+
+    for (run_count_t r2 = r + 1; r2 < batch_end; r2++) {
+      run_idx_t i2 = count_to_run_index(&ctx, r2);
+
+      for (int v = 0; v < ctx.cfg->no_heap_vars; v++) {
+        for (int v2 = 0; v2 < ctx.cfg->no_heap_vars; v2++) {
+          ASSERT(
+            PAGE(ctx.heap_vars[v].values[i]) != PAGE(ctx.heap_vars[v2].values[i2]),
+            "runs %ld and %ld of the same batch share a page",
+            r,
+            r2
+          );
+        }
+      }
+    }
+  }
+}
+
+UNIT_TEST_IF(test_concretization_linear_batch_keeps_relations, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
+void test_concretization_linear_batch_keeps_relations(void) {
+  litmus_test_t test = {
+    "test",
+    0,
+    NULL,
+    3,
+    (const char*[]){ "x", "y", "z" },
+    0,
+    NULL,
+    INIT_STATE(
+      7,
+      INIT_VAR(x, 0),
+      INIT_VAR(y, 0),
+      INIT_VAR(z, 0),
+      INIT_REGION_OWN(x, REGION_OWN_PMD),
+      INIT_REGION_PIN(y, x, REGION_SAME_PMD),
+      INIT_REGION_OWN(z, REGION_OWN_PAGE),
+      INIT_REGION_OFFSET(z, x, REGION_SAME_PAGE_OFFSET),
+    ),
+  };
+
+  test_ctx_t ctx;
+
+  init_test_ctx(&ctx, &test, SIZE_OF_TEST, BATCH_SIZE);
+  initialize_regions(&ctx.heap_memory);
+  void* st = concretize_init(CONCRETE_LINEAR, &ctx, ctx.cfg, ctx.no_runs);
+  concretize(CONCRETE_LINEAR, &ctx, ctx.cfg, st, ctx.no_runs);
+
+  /* whichever slot the run is in, the pin and the offset still hold */
+  for (run_idx_t r = 0; r < ctx.no_runs; r++) {
+    u64* x = ctx.heap_vars[0].values[r];
+    u64* y = ctx.heap_vars[1].values[r];
+    u64* z = ctx.heap_vars[2].values[r];
+
+    ASSERT(PMD(x) == PMD(y), "x and y in different pmds");
+    ASSERT(x != y, "x and y at the same va");
+    ASSERT(PMD(z) != PMD(x), "z in x's pmd");
+    ASSERT(PAGEOFF(z) == PAGEOFF(x), "z and x had different page offsets");
+  }
+}
+
+UNIT_TEST_IF(test_concretization_linear_unplaced_var, ENABLE_UNITTESTS_CONCRETIZATION_TEST_LINEAR)
+void test_concretization_linear_unplaced_var(void) {
+  /* y neither owns a region nor is pinned to one */
+  litmus_test_t test = {
+    "test",
+    0,
+    NULL,
+    2,
+    (const char*[]){ "x", "y" },
+    0,
+    NULL,
+    INIT_STATE(2, INIT_VAR(x, 0), INIT_REGION_OWN(x, REGION_OWN_PAGE), )
+  };
+
+  test_ctx_t ctx;
+
+  init_test_ctx(&ctx, &test, SIZE_OF_TEST, 1);
+  initialize_regions(&ctx.heap_memory);
+  var_info_t* unplaced = concretize_linear_unplaced_var(&ctx, ctx.cfg);
+
+  ASSERT(unplaced == &ctx.heap_vars[1], "did not find y unplaced");
+}
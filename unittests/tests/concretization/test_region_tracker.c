@@ -0,0 +1,53 @@
+#include "lib.h"
+#include "testlib.h"
+
+#define TESTDATA_OFFS(reg, offs) (BOT_OF_TESTDATA + (reg) * REGION_SIZE + (offs))
+
+UNIT_TEST(test_region_tracker_find_free_page)
+void test_region_tracker_find_free_page(void) {
+  region_trackers_t* trackers = alloc_region_trackers();
+  u64 offs;
+
+  /* take pages 2 and 3 of region 1 */
+  tracker_mark(trackers, TESTDATA_OFFS(1, 2 * PAGE_SIZE));
+  tracker_mark(trackers, TESTDATA_OFFS(1, 3 * PAGE_SIZE + 0x100));
+
+  bool found_below = tracker_find_free_page(trackers, 1, 3 * PAGE_SIZE + 0x80, &offs);
+  u64 below = offs;
+  bool found_free = tracker_find_free_page(trackers, 1, 4 * PAGE_SIZE, &offs);
+  u64 unmoved = offs;
+  bool taken = tracker_is_taken(trackers, TESTDATA_OFFS(1, 3 * PAGE_SIZE + 0x100));
+
+  tracker_clear(trackers);
+  bool cleared = !tracker_is_taken(trackers, TESTDATA_OFFS(1, 3 * PAGE_SIZE + 0x100));
+  free_region_trackers(trackers);
+
+  ASSERT(found_below && below == PAGE_SIZE, "did not skip down over the taken pages");
+  ASSERT(found_free && unmoved == 4 * PAGE_SIZE, "moved a free page");
+  ASSERT(taken, "did not mark the line");
+  ASSERT(cleared, "did not clear the line");
+}
+
+UNIT_TEST(test_region_tracker_find_free_dir)
+void test_region_tracker_find_free_dir(void) {
+  region_trackers_t* trackers = alloc_region_trackers();
+  u64 offs;
+
+  /* take something in dirs 0 and 1 of region 0 */
+  tracker_mark(trackers, TESTDATA_OFFS(0, 0));
+  tracker_mark(trackers, TESTDATA_OFFS(0, DIR_SIZE + PAGE_SIZE));
+
+  /* nothing free at or below dir 1, so wraps to the top dir */
+  bool found_wrap = tracker_find_free_dir(trackers, 0, DIR_SIZE, &offs);
+  u64 wrapped = offs;
+
+  for (u64 d = 2; d < NR_DIRS_PER_REGION; d++) {
+    tracker_mark(trackers, TESTDATA_OFFS(0, d * DIR_SIZE));
+  }
+
+  bool found_full = tracker_find_free_dir(trackers, 0, DIR_SIZE, &offs);
+  free_region_trackers(trackers);
+
+  ASSERT(found_wrap && wrapped == (NR_DIRS_PER_REGION - 1) * DIR_SIZE, "did not wrap around to the top dir");
+  ASSERT(!found_full, "found a free dir in a full region");
+}
@@ -0,0 +1,18 @@
+#include "lib.h"
+#include "testlib.h"
+
+UNIT_TEST(test_pmu_event_from_str_hex)
+void test_pmu_event_from_str_hex(void) {
+  ASSERT(pmu_event_from_str("0x2D") == 0x2D, "0x2D parsed as 0x%lx", pmu_event_from_str("0x2D"));
+  ASSERT(pmu_event_from_str("0x2d") == 0x2D, "0x2d parsed as 0x%lx", pmu_event_from_str("0x2d"));
+  ASSERT(pmu_event_from_str("0xffff") == 0xffff, "0xffff parsed as 0x%lx", pmu_event_from_str("0xffff"));
+  ASSERT(pmu_event_from_str("0x10000") == PMU_EVENT_UNKNOWN, "accepted an event above 0xffff");
+  ASSERT(pmu_event_from_str("0x2g") == PMU_EVENT_UNKNOWN, "accepted a non-hex digit");
+  ASSERT(pmu_event_from_str("0x") == PMU_EVENT_UNKNOWN, "accepted no digits");
+}
+
+UNIT_TEST(test_pmu_event_from_str_name)
+void test_pmu_event_from_str_name(void) {
+  ASSERT(pmu_event_from_str("l2d_tlb_refill") == 0x2D, "l2d_tlb_refill is not 0x2D");
+  ASSERT(pmu_event_from_str("not_an_event") == PMU_EVENT_UNKNOWN, "accepted an unknown name");
+}
@@ -0,0 +1,22 @@
+
+#include "lib.h"
+#include "testlib.h"
+
+UNIT_TEST(test_permutation_is_bijection)
+void test_permutation_is_bijection(void) {
+  permutation_t perm;
+  u64 n = 1000;
+  u8* seen = ALLOC_MANY(u8, n);
+
+  init_permutation(&perm, n);
+
+  for (u64 i = 0; i < n; i++) {
+    u64 p = permute(&perm, i);
+    ASSERT(p < n, "permute(%ld) = %ld out of range", i, p);
+    ASSERT(!seen[p], "permute(%ld) = %ld seen twice", i, p);
+    ASSERT(unpermute(&perm, p) == i, "unpermute(permute(%ld)) != %ld", i, i);
+    seen[p] = 1;
+  }
+
+  FREE(seen);
+}
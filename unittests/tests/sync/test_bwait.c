@@ -28,4 +28,59 @@ void test_bwaits_nodeadlock(void) {
   }
 
   ASSERT(1); /* assert we reach the end */
-}
\ No newline at end of file
+}
+typedef struct
+{
+  bar_t* bar;
+  u64 sz;
+  volatile u64 arrived[MAX_CPUS];
+  volatile u64 early[MAX_CPUS];
+} bar_order_test_t;
+
+void test_bwaits_order_cpu(int cpu, void* arg) {
+  bar_order_test_t* test = arg;
+  if (cpu >= test->sz)
+    return;
+
+  for (int i = 1; i <= 100; i++) {
+    test->arrived[cpu] = i;
+    BWAIT(cpu, test->bar, test->sz);
+
+    /* nobody may leave the barrier before everyone has arrived */
+    for (int j = 0; j < test->sz; j++) {
+      if (test->arrived[j] < i)
+        test->early[cpu] = 1;
+    }
+
+    BWAIT(cpu, test->bar, test->sz);
+  }
+}
+
+UNIT_TEST(test_bwaits_lockfree_waits_for_all)
+void test_bwaits_lockfree_waits_for_all(void) {
+  static bar_t bar = EMPTY_BAR;
+  static bar_order_test_t test = {
+    .bar = &bar,
+    .sz = 0,
+  };
+
+  barrier_type_t old_type = BARRIER_TYPE;
+  int early_sz = 0;
+
+  BARRIER_TYPE = BARRIER_LOCKFREE;
+  for (int n = 1; n <= NO_CPUS; n++) {
+    test.sz = n;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+      test.arrived[cpu] = 0;
+      test.early[cpu] = 0;
+    }
+    run_on_cpus((async_fn_t*)test_bwaits_order_cpu, (void*)&test);
+    for (int cpu = 0; cpu < n; cpu++) {
+      if (test.early[cpu] && early_sz == 0)
+        early_sz = n;
+    }
+  }
+  BARRIER_TYPE = old_type;
+
+  ASSERT(early_sz == 0, "a cpu left the barrier early (sz=%d)", early_sz);
+}
@@ -0,0 +1,43 @@
+
+#include "lib.h"
+#include "testlib.h"
+
+static litmus_test_t pgtable_test = {
+  "pgtable test",
+  0,
+  NULL,
+  2,
+  (const char*[]){ "x", "y" },
+  0,
+  NULL,
+  .interesting_result = NULL,
+  .requires = REQUIRES_PGTABLE,
+};
+
+UNIT_TEST(test_ctx_asid_generations)
+void test_ctx_asid_generations(void) {
+  test_ctx_t ctx;
+  u64 batch_size = 100;
+  u64 no_runs = 2000;
+  u64 per_generation = MAX_ASID / batch_size;
+
+  init_test_ctx(&ctx, &pgtable_test, no_runs, batch_size);
+
+  for (run_count_t r = 0; r < no_runs; r += batch_size) {
+    bool starts = asid_generation_starts_at(&ctx, r);
+    ASSERT(starts == ((r / batch_size) % per_generation == 0), "batch %ld: wrong generation start", r / batch_size);
+  }
+
+  /* within a generation, every run gets a distinct non-zero ASID */
+  u64 generation_runs = MIN(per_generation * batch_size, no_runs);
+  for (run_count_t r0 = 0; r0 < generation_runs; r0++) {
+    u64 asid0 = asid_from_run_count(&ctx, r0);
+    ASSERT(0 < asid0 && asid0 <= MAX_ASID, "run %ld: ASID %ld out of range", r0, asid0);
+
+    for (run_count_t r1 = r0 + 1; r1 < generation_runs; r1++) {
+      ASSERT(asid0 != asid_from_run_count(&ctx, r1), "runs %ld and %ld share an ASID", r0, r1);
+    }
+  }
+
+  free_test_ctx(&ctx);
+}
@@ -0,0 +1,38 @@
+
+#include "lib.h"
+#include "testlib.h"
+
+static litmus_test_t pgtable_test = {
+  "pgtable test",
+  0,
+  NULL,
+  2,
+  (const char*[]){ "x", "y" },
+  0,
+  NULL,
+  .interesting_result = NULL,
+  .requires = REQUIRES_PGTABLE,
+};
+
+UNIT_TEST(test_ctx_groups_disjoint)
+void test_ctx_groups_disjoint(void) {
+  test_ctx_t ctx0;
+  test_ctx_t ctx1;
+
+  init_test_ctx(&ctx0, &pgtable_test, 100, 10);
+  init_test_ctx(&ctx1, &pgtable_test, 100, 10);
+  set_ctx_cpu_group(&ctx0, 0, 2);
+  set_ctx_cpu_group(&ctx1, 1, 2);
+
+  ASSERT(ctx0.cpu_base + ctx0.no_cpus <= ctx1.cpu_base, "overlapping CPUs");
+  ASSERT(region_idx_top(&ctx0).reg_ix < region_idx_bottom(&ctx1).reg_ix, "overlapping regions");
+
+  for (run_count_t r0 = 0; r0 < ctx0.batch_size; r0++) {
+    for (run_count_t r1 = 0; r1 < ctx1.batch_size; r1++) {
+      ASSERT(asid_from_run_count(&ctx0, r0) != asid_from_run_count(&ctx1, r1), "overlapping ASIDs");
+    }
+  }
+
+  free_test_ctx(&ctx1);
+  free_test_ctx(&ctx0);
+}
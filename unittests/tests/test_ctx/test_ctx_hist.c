@@ -0,0 +1,41 @@
+#include "lib.h"
+#include "testlib.h"
+
+static litmus_test_t two_reg_test = {
+  "two reg test", 0, NULL, 0, NULL, 2, (const char*[]){ "r", "s" }, .interesting_result = NULL,
+};
+
+UNIT_TEST(test_hist_many_outcomes)
+void test_hist_many_outcomes(void) {
+  test_ctx_t ctx;
+  init_test_ctx(&ctx, &two_reg_test, 5000, 1);
+
+  /* 1000 distinct outcomes, each seen 5 times
+   * more than would fit in the initial table, so forces it to grow */
+  for (run_idx_t i = 0; i < ctx.no_runs; i++) {
+    ctx.out_regs[0][i] = i % 1000;
+    ctx.out_regs[1][i] = (i % 1000) << 32;
+  }
+
+  /* there may only be one CPU, and so only one staging histogram,
+   * so stage and merge each half in turn */
+  stage_results(&ctx, ctx.staged_hists[0], 0, 2500);
+  merge_results(&ctx, ctx.hist, ctx.staged_hists[0]);
+  stage_results(&ctx, ctx.staged_hists[0], 2500, ctx.no_runs);
+  merge_results(&ctx, ctx.hist, ctx.staged_hists[0]);
+
+  u64 allocated = ctx.hist->allocated;
+  u64 staged = ctx.staged_hists[0]->allocated;
+  u64 wrong_count = 0;
+  for (u64 r = 0; r < allocated; r++) {
+    test_result_t* result = hist_result(ctx.hist, r);
+    if (result->counter != 5 || result->values[1] != result->values[0] << 32)
+      wrong_count++;
+  }
+
+  free_test_ctx(&ctx);
+
+  ASSERT(allocated == 1000, "expected 1000 outcomes but got %ld", allocated);
+  ASSERT(staged == 0, "staging histograms were not cleared by merge");
+  ASSERT(wrong_count == 0, "%ld outcomes had the wrong counts or values", wrong_count);
+}
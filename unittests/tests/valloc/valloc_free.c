@@ -13,13 +13,14 @@ void test_valloc_free_reuse(void) {
 
 UNIT_TEST(test_valloc_freelist)
 void test_valloc_freelist(void) {
-  char* p = alloc(64);
-  char* q = alloc(64);
+  /* too big for a slab, so they go on the freelist */
+  char* p = alloc(2 * SLAB_MAX_SIZE);
+  char* q = alloc(2 * SLAB_MAX_SIZE);
   free(p);
   /* intentionally no free q */
 
   ASSERT(mem.freelist != NULL, "free still NULL");
-  ASSERT(mem.freelist->size >= 64, "free size too small");
+  ASSERT(mem.freelist->size >= 2 * SLAB_MAX_SIZE, "free size too small");
 
   /* use q to suppress warnings
    * this free is not strictly necessary as the tester should cleanup
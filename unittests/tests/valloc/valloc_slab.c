@@ -0,0 +1,94 @@
+#include "lib.h"
+#include "testlib.h"
+
+UNIT_TEST(test_valloc_slab_small_allocs)
+void test_valloc_slab_small_allocs(void) {
+  valloc_slab_class* cls = &mem.slab_classes[0];
+  u64 allocs = cls->no_allocs;
+
+  char* p = alloc(SLAB_MIN_SIZE);
+  u64 size = valloc_slab_size(p);
+  free(p);
+
+  ASSERT(size == SLAB_MIN_SIZE, "not allocated from a slab");
+  ASSERT(cls->no_allocs == allocs + 1, "did not count the alloc");
+}
+
+UNIT_TEST(test_valloc_slab_big_allocs)
+void test_valloc_slab_big_allocs(void) {
+  char* p = alloc(2 * SLAB_MAX_SIZE);
+  u64 size = valloc_slab_size(p);
+  free(p);
+
+  ASSERT(size == 0, "allocated from a slab");
+}
+
+UNIT_TEST(test_valloc_slab_alignment)
+void test_valloc_slab_alignment(void) {
+  char* p = alloc_with_alignment(8, 64);
+  char* q = alloc_with_alignment(8, 64);
+  free(p);
+  free(q);
+
+  ASSERT(IS_ALIGNED((u64)p, 6), "p not aligned");
+  ASSERT(IS_ALIGNED((u64)q, 6), "q not aligned");
+  ASSERT(p != q, "same object twice");
+}
+
+UNIT_TEST(test_valloc_slab_zeroed)
+void test_valloc_slab_zeroed(void) {
+  u64* p = alloc(SLAB_MIN_SIZE);
+  *p = 0xdead;
+  free(p);
+
+  u64* q = alloc(SLAB_MIN_SIZE);
+  u64 v = *q;
+  free(q);
+
+  ASSERT(v == 0, "not zeroed");
+}
+
+UNIT_TEST(test_valloc_slab_release)
+void test_valloc_slab_release(void) {
+  u64 space = valloc_free_size();
+  u64 top = mem.top;
+  char* ps[256];
+
+  /* enough to need more than one slab */
+  for (int i = 0; i < 256; i++) {
+    ps[i] = alloc(SLAB_MIN_SIZE);
+  }
+
+  for (int i = 0; i < 256; i++) {
+    free(ps[i]);
+  }
+
+  ASSERT(valloc_free_size() == space, "did not free all space");
+  ASSERT(mem.top == top, "did not give back the slabs");
+}
+
+UNIT_TEST(test_valloc_slab_keeps_empty)
+void test_valloc_slab_keeps_empty(void) {
+  valloc_slab_class* cls = &mem.slab_classes[0];
+  char* ps[256];
+
+  for (int i = 0; i < 256; i++) {
+    ps[i] = alloc(SLAB_MIN_SIZE);
+  }
+
+  for (int i = 0; i < 256; i++) {
+    free(ps[i]);
+  }
+
+  u64 slab_top = mem.slab_top;
+  u64 no_slabs = cls->no_slabs;
+
+  for (int i = 0; i < 16; i++) {
+    free(alloc(SLAB_MIN_SIZE));
+  }
+
+  ASSERT(cls->empty != NULL, "no empty slab kept");
+  ASSERT(cls->empty->no_used == 0, "kept slab not empty");
+  ASSERT(cls->no_slabs == no_slabs, "took or gave back a slab");
+  ASSERT(mem.slab_top == slab_top, "moved slab_top");
+}
@@ -0,0 +1,28 @@
+#include "lib.h"
+#include "testlib.h"
+
+UNIT_TEST(test_vmm_test_pgtables_copy_on_write)
+void test_vmm_test_pgtables_copy_on_write(void) {
+  valloc_ptable_mem chk = valloc_ptable_checkpoint();
+  u64* t1 = vmm_alloc_new_test_pgtable();
+  u64* t2 = vmm_alloc_new_test_pgtable();
+  u64 va = BOT_OF_TESTDATA;
+
+  u64* pte1 = vmm_pte(t1, va);
+  u64* pte2 = vmm_pte(t2, va);
+  bool copied = !vmm_table_is_shared((u64*)((u64)pte1 & ~BITMASK(PAGE_SHIFT)));
+
+  u64 old = *pte1;
+  *pte1 = 0;
+  u64 pa1 = (u64)vmm_pa(t1, va);
+  u64 pa2 = (u64)vmm_pa(t2, va);
+  *pte1 = old;
+
+  /* give back the pgtables before any assert can return */
+  valloc_ptable_restore(chk);
+
+  ASSERT(pte1 != pte2, "both pgtables have the same pte for %p at %p", va, pte1);
+  ASSERT(copied, "pte for %p was not copied", va);
+  ASSERT(pa1 == 0, "did not unmap %p", va);
+  ASSERT(pa2 == va, "unmapping %p in one pgtable changed the other", va);
+}
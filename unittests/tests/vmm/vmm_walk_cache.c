@@ -0,0 +1,29 @@
+#include "lib.h"
+#include "testlib.h"
+
+UNIT_TEST(test_vmm_walk_cache_flushed_on_update)
+void test_vmm_walk_cache_flushed_on_update(void) {
+  valloc_ptable_mem chk = valloc_ptable_checkpoint();
+  u64* pgtable = vmm_alloc_new_test_pgtable();
+  u64 va = BOT_OF_TESTDATA;
+
+  u64* pte = vmm_pte(pgtable, va);
+  bool cached = vmm_walk_cache_lookup(pgtable, va) != NULL;
+  bool same_pte = vmm_pte(pgtable, va) == pte;
+
+  /* unmapping the whole 2M region changes the walk */
+  u64* pmd = vmm_pte_at_level(pgtable, va, 2);
+  u64 old = *pmd;
+  vmm_update_pte(pmd, 0, SYNC_NONE, 0, false);
+  bool flushed = vmm_walk_cache_lookup(pgtable, va) == NULL;
+  bool unmapped = vmm_pa(pgtable, va) == NULL;
+  vmm_update_pte(pmd, old, SYNC_NONE, 0, false);
+
+  /* give back the pgtable before any assert can return */
+  valloc_ptable_restore(chk);
+
+  ASSERT(cached, "walk for %p was not cached", va);
+  ASSERT(same_pte, "cached walk for %p gave a different pte", va);
+  ASSERT(flushed, "walk for %p was not flushed", va);
+  ASSERT(unmapped, "%p still mapped", va);
+}